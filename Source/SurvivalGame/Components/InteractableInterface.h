@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "InteractableInterface.generated.h"
+
+UINTERFACE(MinimalAPI)
+class UInteractableInterface : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Implemented by actors that keep a pointer to their interaction component, so players walking past can get it straight from
+ * the actor instead of searching through its components. Actors without it are still found, just the slow way.
+ */
+class SURVIVALGAME_API IInteractableInterface
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual class UInteractionComponent* GetActorInteractionComponent() const = 0;
+};
@@ -1,6 +1,46 @@
 #include "InteractionComponent.h"
-#include "Widgets/InteractionWidget.h"
 #include "Player/SurvivalCharacter.h"
+#include "Components/InteractionPromptComponent.h"
+#include "Components/InteractableInterface.h"
+#include "Components/WidgetComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+// Logs how much memory interactables and widget components are using. Run it on a headless server to check it carries no UI
+static FAutoConsoleCommand InteractionMemoryReportCommand(
+	TEXT("Survival.InteractionMemoryReport"),
+	TEXT("Logs the count and memory of every live interaction component and widget component"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		int32 NumInteractables = 0;
+		int64 InteractableBytes = 0;
+
+		for (TObjectIterator<UInteractionComponent> It; It; ++It)
+		{
+			if (!It->HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+			{
+				InteractableBytes += It->GetClass()->GetStructureSize() + It->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+				++NumInteractables;
+			}
+		}
+
+		int32 NumWidgetComponents = 0;
+		int64 WidgetComponentBytes = 0;
+
+		for (TObjectIterator<UWidgetComponent> It; It; ++It)
+		{
+			if (!It->HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+			{
+				WidgetComponentBytes += It->GetClass()->GetStructureSize() + It->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+				++NumWidgetComponents;
+			}
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("%d interaction components using %lld bytes (%lld each). A widget component based interactable was at least %d bytes each"),
+			NumInteractables, InteractableBytes, NumInteractables > 0 ? InteractableBytes / NumInteractables : 0, UWidgetComponent::StaticClass()->GetStructureSize());
+		UE_LOG(LogTemp, Log, TEXT("%d widget components using %lld bytes"), NumWidgetComponents, WidgetComponentBytes);
+	})
+);
 
 void UInteractionComponent::Deactivate()
 {
@@ -18,6 +58,59 @@ void UInteractionComponent::Deactivate()
 	Interactors.Empty();
 }
 
+void UInteractionComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	bPrimitiveCacheDirty = true;
+}
+
+void UInteractionComponent::OnUnregister()
+{
+	CachedPrimitives.Empty();
+
+	Super::OnUnregister();
+}
+
+UInteractionComponent* UInteractionComponent::FindOnActor(const AActor* Actor)
+{
+	if (const IInteractableInterface* Interactable = Cast<IInteractableInterface>(Actor))
+	{
+		return Interactable->GetActorInteractionComponent();
+	}
+
+	return Actor ? Actor->FindComponentByClass<UInteractionComponent>() : nullptr;
+}
+
+void UInteractionComponent::SetOwnerRenderCustomDepth(const bool bRenderCustomDepth)
+{
+	const TSet<UActorComponent*>& OwnerComponents = GetOwner()->GetComponents();
+
+	if (bPrimitiveCacheDirty || OwnerComponents.Num() != CachedOwnerComponentCount)
+	{
+		CachedPrimitives.Reset();
+
+		for (UActorComponent* Component : OwnerComponents)
+		{
+			if (UPrimitiveComponent* Prim = Cast<UPrimitiveComponent>(Component))
+			{
+				CachedPrimitives.Add(Prim);
+			}
+		}
+
+		CachedOwnerComponentCount = OwnerComponents.Num();
+		bPrimitiveCacheDirty = false;
+	}
+
+	for (const TWeakObjectPtr<UPrimitiveComponent>& Prim : CachedPrimitives)
+	{
+		if (Prim.IsValid())
+		{
+			Prim->SetRenderCustomDepth(bRenderCustomDepth);
+		}
+	}
+}
+
 bool UInteractionComponent::CanInteract(ASurvivalCharacter* Character) const
 {
 	const bool bPlayerAlreadyInteracting = !bAllowMultipleInteractors && Interactors.Num() >= 1;
@@ -26,20 +119,24 @@ bool UInteractionComponent::CanInteract(ASurvivalCharacter* Character) const
 
 UInteractionComponent::UInteractionComponent()
 {
-	SetComponentTickEnabled(false);
+	PrimaryComponentTick.bCanEverTick = false;
 
 	InteractionTime = 0.f;
 	InteractionDistance = 200.f;
 	InteractableNameText = FText::FromString("Interactable Object");
 	InteractableActionText = FText::FromString("Interact");
 	bAllowMultipleInteractors = true;
+	PromptOffset = FVector::ZeroVector;
 
-	Space = EWidgetSpace::Screen;
-	DrawSize = FIntPoint(600, 100);
-	bDrawAtDesiredSize = true;
+	CachedOwnerComponentCount = 0;
+	bPrimitiveCacheDirty = true;
 
 	SetActive(true);
-	SetHiddenInGame(true);
+}
+
+FVector UInteractionComponent::GetPromptLocation() const
+{
+	return GetOwner() ? GetOwner()->GetActorTransform().TransformPosition(PromptOffset) : PromptOffset;
 }
 
 void UInteractionComponent::SetInteractableNameText(const FText& NewNameText)
@@ -56,12 +153,9 @@ void UInteractionComponent::SetInteractableActionText(const FText& NewActionText
 
 void UInteractionComponent::RefreshWidget()
 {
-	if (!bHiddenInGame && GetOwner()->GetNetMode() != NM_DedicatedServer)
+	if (UInteractionPromptComponent* Prompt = FocusedPrompt.Get())
 	{
-		if (UInteractionWidget* InteractionWidget = Cast<UInteractionWidget>(GetUserWidgetObject()))
-		{
-			InteractionWidget->UpdateInteractionWidget(this);
-		}
+		Prompt->RefreshPrompt(this);
 	}
 }
 
@@ -76,18 +170,15 @@ void UInteractionComponent::BeginFocus(ASurvivalCharacter* Character)
 
 	if (GetNetMode() != NM_DedicatedServer)
 	{
-		SetHiddenInGame(false);
+		SetOwnerRenderCustomDepth(true);
 
-		for (auto& VisualComp : GetOwner()->GetComponentsByClass(UPrimitiveComponent::StaticClass()))
+		// Only the local player has a prompt to show
+		if (UInteractionPromptComponent* Prompt = UInteractionPromptComponent::Get(Character))
 		{
-			if (UPrimitiveComponent* Prim = Cast<UPrimitiveComponent>(VisualComp))
-			{
-				Prim->SetRenderCustomDepth(true);
-			}
+			FocusedPrompt = Prompt;
+			Prompt->ShowPrompt(this);
 		}
 	}
-
-	RefreshWidget();
 }
 
 void UInteractionComponent::EndFocus(ASurvivalCharacter* Character)
@@ -96,15 +187,22 @@ void UInteractionComponent::EndFocus(ASurvivalCharacter* Character)
 
 	if (GetNetMode() != NM_DedicatedServer)
 	{
-		SetHiddenInGame(true);
+		SetOwnerRenderCustomDepth(false);
 
-		for (auto& VisualComp : GetOwner()->GetComponentsByClass(UPrimitiveComponent::StaticClass()))
+		if (UInteractionPromptComponent* Prompt = FocusedPrompt.Get())
 		{
-			if (UPrimitiveComponent* Prim = Cast<UPrimitiveComponent>(VisualComp))
-			{
-				Prim->SetRenderCustomDepth(false);
-			}
+			Prompt->HidePrompt(this);
 		}
+
+		FocusedPrompt.Reset();
+	}
+}
+
+void UInteractionComponent::RefreshProgress(ASurvivalCharacter* Character)
+{
+	if (UInteractionPromptComponent* Prompt = FocusedPrompt.Get())
+	{
+		Prompt->RefreshProgress(this, Character);
 	}
 }
 
@@ -114,6 +212,8 @@ void UInteractionComponent::BeginInteract(ASurvivalCharacter* Character)
 	{
 		Interactors.AddUnique(Character);
 		OnBeginInteract.Broadcast(Character);
+
+		RefreshProgress(Character);
 	}
 }
 
@@ -121,6 +221,8 @@ void UInteractionComponent::EndInteract(ASurvivalCharacter* Character)
 {
 	Interactors.RemoveSingle(Character);
 	OnEndInteract.Broadcast(Character);
+
+	RefreshProgress(Character);
 }
 
 void UInteractionComponent::Interact(ASurvivalCharacter* Character)
@@ -128,6 +230,8 @@ void UInteractionComponent::Interact(ASurvivalCharacter* Character)
 	if (CanInteract(Character))
 	{
 		OnInteract.Broadcast(Character);
+
+		RefreshProgress(Character);
 	}
 }
 
@@ -3,7 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "Components/WidgetComponent.h"
+#include "Components/ActorComponent.h"
 #include "InteractionComponent.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnBeginInteract, class ASurvivalCharacter*, Character);
@@ -13,10 +13,11 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEndFocus, class ASurvivalCharacte
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInteract, class ASurvivalCharacter*, Character);
 
 /**
- * 
+ * Makes its owner something players can interact with. This only holds interaction state and delegates, and has no
+ * transform or UI of its own. The prompt players see is drawn by the local players UInteractionPromptComponent.
  */
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
-class SURVIVALGAME_API UInteractionComponent : public UWidgetComponent
+class SURVIVALGAME_API UInteractionComponent : public UActorComponent
 {
 	GENERATED_BODY()
 
@@ -24,6 +25,25 @@ protected:
 	// Called when the game starts
 	virtual void Deactivate() override;
 
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+
+	// Turn the outline on or off for every primitive on our owner
+	void SetOwnerRenderCustomDepth(const bool bRenderCustomDepth);
+
+	// Our owners primitive components, so focusing doesn't have to look them up every time
+	TArray<TWeakObjectPtr<class UPrimitiveComponent>> CachedPrimitives;
+
+	// How many components our owner had when CachedPrimitives was built. If this changes the cache is rebuilt
+	int32 CachedOwnerComponentCount;
+	bool bPrimitiveCacheDirty;
+
+	// The prompt showing for us while the local player is focused on us
+	TWeakObjectPtr<class UInteractionPromptComponent> FocusedPrompt;
+
+	// Let the prompt know an interaction started or stopped, if it's showing for us
+	void RefreshProgress(class ASurvivalCharacter* Character);
+
 	bool CanInteract(class ASurvivalCharacter* Character) const;
 
 	// On the server, this will hold all interactors. On the local client, this will just hold the local player
@@ -49,6 +69,16 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction")
 	FText InteractableActionText;
 
+	// Where the interaction prompt is drawn, relative to our owner
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction")
+	FVector PromptOffset;
+
+	FVector GetPromptLocation() const;
+
+	// The widget the prompt uses for this interactable. Leave empty to use the HUDs InteractionWidgetClass
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction")
+	TSubclassOf<class UInteractionWidget> InteractionWidgetClass;
+
 	// Whether we allow multiple players to interact with the item, or just one at any given time
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction")
 	bool bAllowMultipleInteractors;
@@ -60,9 +90,18 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Interaction")
 	void SetInteractableActionText(const FText& NewActionText);
 
-	// Refresh the interaction widget and its custom widgets
+	// Refresh the interaction prompt, if the local player is focused on us
 	void RefreshWidget();
 
+	// Find an actors interaction component, if it has one. Asks the actor first, see IInteractableInterface
+	static UInteractionComponent* FindOnActor(const AActor* Actor);
+
+	// Rebuild the cached primitive list next time it's needed. Call this after adding or removing primitives at runtime
+	void InvalidatePrimitiveCache() { bPrimitiveCacheDirty = true; }
+
+	// True if anyone is interacting with this component
+	FORCEINLINE bool HasInteractors() const { return Interactors.Num() > 0; }
+
 	// Delegates
 
 	// [local + server] Called when the player presses the interact key whilst focusing on this interactable actor
@@ -97,6 +136,7 @@ public:
 
 	// Returns a value from 0-1 denoting how far through the interact we are
 	// On the server this is the first interactors percentage, on client this is the local interactors percentage
+	// Widgets should animate from UInteractionWidget::InteractStartTime instead of polling this every frame
 	UFUNCTION(BlueprintPure, Category = "Interaction")
 	float GetInteractPercentage();
 
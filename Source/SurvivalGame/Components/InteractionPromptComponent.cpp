@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InteractionPromptComponent.h"
+#include "Components/InteractionComponent.h"
+#include "Player/SurvivalHUD.h"
+#include "Widgets/InteractionWidget.h"
+#include "Player/SurvivalCharacter.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+
+UInteractionPromptComponent::UInteractionPromptComponent()
+{
+	Space = EWidgetSpace::Screen;
+	DrawSize = FIntPoint(600, 100);
+	bDrawAtDesiredSize = true;
+
+	SetHiddenInGame(true);
+
+	PromptInteractable = nullptr;
+	bRefreshQueued = false;
+	bContentDirty = false;
+	bProgressDirty = false;
+}
+
+UInteractionPromptComponent* UInteractionPromptComponent::Get(const APawn* Pawn)
+{
+	const ASurvivalHUD* HUD = ASurvivalHUD::Get(Pawn);
+	return HUD ? HUD->InteractionPrompt : nullptr;
+}
+
+void UInteractionPromptComponent::ShowPrompt(UInteractionComponent* Interactable)
+{
+	if (!Interactable)
+	{
+		return;
+	}
+
+	PromptInteractable = Interactable;
+	ProgressInteractor.Reset();
+
+	// Only swaps the widget when the class changes, so looking between pickups of the same kind reuses it
+	TSubclassOf<UUserWidget> PromptWidgetClass = Interactable->InteractionWidgetClass ? TSubclassOf<UUserWidget>(Interactable->InteractionWidgetClass) : DefaultWidgetClass;
+	SetWidgetClass(PromptWidgetClass);
+
+	SetWorldLocation(Interactable->GetPromptLocation());
+
+	// Stays hidden until the flush has filled the widget in, so it never shows the last interactables text
+	bContentDirty = true;
+	bProgressDirty = true;
+	QueueRefresh();
+}
+
+void UInteractionPromptComponent::HidePrompt(UInteractionComponent* Interactable)
+{
+	if (Interactable == PromptInteractable)
+	{
+		PromptInteractable = nullptr;
+		ProgressInteractor.Reset();
+		SetHiddenInGame(true);
+	}
+}
+
+void UInteractionPromptComponent::RefreshPrompt(UInteractionComponent* Interactable)
+{
+	if (Interactable && Interactable == PromptInteractable)
+	{
+		bContentDirty = true;
+		QueueRefresh();
+	}
+}
+
+void UInteractionPromptComponent::RefreshProgress(UInteractionComponent* Interactable, ASurvivalCharacter* Interactor)
+{
+	if (Interactable && Interactable == PromptInteractable)
+	{
+		ProgressInteractor = Interactor;
+		bProgressDirty = true;
+		QueueRefresh();
+	}
+}
+
+void UInteractionPromptComponent::SetDefaultWidgetClass(TSubclassOf<UUserWidget> InWidgetClass)
+{
+	DefaultWidgetClass = InWidgetClass;
+}
+
+void UInteractionPromptComponent::QueueRefresh()
+{
+	if (!bRefreshQueued)
+	{
+		bRefreshQueued = true;
+		GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UInteractionPromptComponent::FlushRefresh);
+	}
+}
+
+void UInteractionPromptComponent::FlushRefresh()
+{
+	bRefreshQueued = false;
+
+	// Hidden prompts don't update. Showing the prompt again marks everything dirty anyway
+	if (!PromptInteractable)
+	{
+		bContentDirty = false;
+		bProgressDirty = false;
+		return;
+	}
+
+	if (UInteractionWidget* InteractionWidget = Cast<UInteractionWidget>(GetUserWidgetObject()))
+	{
+		if (bContentDirty)
+		{
+			InteractionWidget->UpdateInteractionWidget(PromptInteractable);
+		}
+
+		if (bProgressDirty)
+		{
+			// Work out when the interaction started from the time left on it, so the widget can animate the rest itself
+			const ASurvivalCharacter* Interactor = ProgressInteractor.Get();
+
+			if (Interactor && Interactor->IsInteracting() && PromptInteractable->InteractionTime > 0.f)
+			{
+				const float Duration = PromptInteractable->InteractionTime;
+				InteractionWidget->SetInteractProgress(GetWorld()->GetTimeSeconds() - (Duration - Interactor->GetRemainingInteractTime()), Duration);
+			}
+			else
+			{
+				InteractionWidget->SetInteractProgress(-1.f, 0.f);
+			}
+		}
+	}
+
+	bContentDirty = false;
+	bProgressDirty = false;
+
+	SetHiddenInGame(false);
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/WidgetComponent.h"
+#include "InteractionPromptComponent.generated.h"
+
+/**
+ * Draws the interaction widget for whichever interactable the local player is focused on. This is the only part of
+ * interaction that touches UI, and it lives on ASurvivalHUD, so it is never created on a dedicated server.
+ * Refreshes are coalesced and pushed to the widget at most once a frame, and never while the prompt is hidden.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class SURVIVALGAME_API UInteractionPromptComponent : public UWidgetComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UInteractionPromptComponent();
+
+	// The prompt of the player controlling a character, if they are a local player
+	static UInteractionPromptComponent* Get(const class APawn* Pawn);
+
+	// Move the prompt onto an interactable and show it
+	void ShowPrompt(class UInteractionComponent* Interactable);
+
+	// Hide the prompt, if it's showing for this interactable
+	void HidePrompt(class UInteractionComponent* Interactable);
+
+	// Update the prompt with the interactables latest name and action next frame, if it's showing for it
+	void RefreshPrompt(class UInteractionComponent* Interactable);
+
+	// Update the prompts progress next frame, from whether Interactor is still interacting
+	void RefreshProgress(class UInteractionComponent* Interactable, class ASurvivalCharacter* Interactor);
+
+	// The widget to use for interactables that don't set their own InteractionWidgetClass
+	void SetDefaultWidgetClass(TSubclassOf<class UUserWidget> InWidgetClass);
+
+protected:
+
+	// Push everything that changed since the last flush to the widget
+	void FlushRefresh();
+
+	void QueueRefresh();
+
+	TSubclassOf<class UUserWidget> DefaultWidgetClass;
+
+	bool bRefreshQueued;
+	bool bContentDirty;
+	bool bProgressDirty;
+
+	// The local player, whose interaction progress the prompt shows
+	TWeakObjectPtr<class ASurvivalCharacter> ProgressInteractor;
+
+	// The interactable the prompt is showing for
+	UPROPERTY()
+	class UInteractionComponent* PromptInteractable;
+
+};
@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InteractionSchedulerComponent.h"
+#include "SurvivalGame.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "GameFramework/GameStateBase.h"
+
+DECLARE_CYCLE_STAT(TEXT("Server Interaction Checks"), STAT_ServerInteractionChecks, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interaction Traces Batched"), STAT_InteractionTracesBatched, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interaction Checks Run"), STAT_InteractionChecksRun, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interaction Checks Deferred"), STAT_InteractionChecksDeferred, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interaction Checks Skipped"), STAT_InteractionChecksSkipped, STATGROUP_SurvivalGame);
+
+UInteractionSchedulerComponent::UInteractionSchedulerComponent()
+{
+	// Only ticks while there are checks to run
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	CheckBudgetMicroseconds = 100.f;
+	MinChecksPerFrame = 1;
+}
+
+UInteractionSchedulerComponent* UInteractionSchedulerComponent::Get(const UObject* WorldContextObject)
+{
+	if (UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull))
+	{
+		if (AGameStateBase* GameState = World->GetGameState())
+		{
+			return GameState->FindComponentByClass<UInteractionSchedulerComponent>();
+		}
+	}
+
+	return nullptr;
+}
+
+void UInteractionSchedulerComponent::QueueInteractionCheck(ASurvivalCharacter* Character)
+{
+	if (GetOwner()->HasAuthority() && Character)
+	{
+		// A player spamming interact only holds one place in the queue
+		if (QueuedCharacters.Contains(Character))
+		{
+			INC_DWORD_STAT(STAT_InteractionChecksSkipped);
+			return;
+		}
+
+		QueuedCharacters.Add(Character);
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UInteractionSchedulerComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	SCOPE_CYCLE_COUNTER(STAT_ServerInteractionChecks);
+
+	FinishChecks();
+	IssueChecks();
+
+	if (QueuedCharacters.Num() == 0 && PendingChecks.Num() == 0)
+	{
+		SetComponentTickEnabled(false);
+	}
+}
+
+void UInteractionSchedulerComponent::FinishChecks()
+{
+	for (const FPendingInteractionCheck& Check : PendingChecks)
+	{
+		ASurvivalCharacter* Character = Check.Character.Get();
+
+		// The player asked again while this was tracing, so the result is for a target they've moved on from
+		if (!Character || Check.Target.RequestSerial != Character->ServerInteractRequestSerial)
+		{
+			INC_DWORD_STAT(STAT_InteractionChecksSkipped);
+			continue;
+		}
+
+		FTraceDatum TraceData;
+
+		if (GetWorld()->QueryTraceData(Check.TraceHandle, TraceData))
+		{
+			// Either nothing is in the way, or the first thing in the way is the target itself
+			const bool bVisible = TraceData.OutHits.Num() == 0 || TraceData.OutHits[0].GetActor() == Check.Target.TargetActor.Get();
+			Character->FinishServerInteractionCheck(Check.Target, bVisible);
+		}
+		else
+		{
+			// The result got dropped, so do it the slow way rather than leave the player hanging
+			Character->FinishServerInteractionCheck(Check.Target, Character->IsInteractionTargetVisible(Check.Target.ViewLocation, Check.Target.TargetLocation, Check.Target.TargetActor.Get()));
+		}
+	}
+
+	PendingChecks.Reset();
+}
+
+void UInteractionSchedulerComponent::IssueChecks()
+{
+	const double EndTime = FPlatformTime::Seconds() + CheckBudgetMicroseconds / 1000000.0;
+	int32 NumProcessed = 0;
+
+	while (NumProcessed < QueuedCharacters.Num())
+	{
+		if (NumProcessed >= MinChecksPerFrame && FPlatformTime::Seconds() >= EndTime)
+		{
+			break;
+		}
+
+		ASurvivalCharacter* Character = QueuedCharacters[NumProcessed++].Get();
+
+		// Players who left, or who were already sorted out another way, don't need a check
+		if (!Character || !Character->bServerInteractPending)
+		{
+			INC_DWORD_STAT(STAT_InteractionChecksSkipped);
+			continue;
+		}
+
+		INC_DWORD_STAT(STAT_InteractionChecksRun);
+
+		const FInteractionTarget& Target = Character->ServerInteractTarget;
+
+		if (Target.TargetActor.IsValid())
+		{
+			FCollisionQueryParams QueryParams;
+			QueryParams.AddIgnoredActor(Character);
+
+			FPendingInteractionCheck& Check = PendingChecks.AddDefaulted_GetRef();
+			Check.Character = Character;
+			Check.Target = Target;
+			Check.TraceHandle = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Target.ViewLocation, Target.TargetLocation, ECC_Visibility, QueryParams);
+
+			INC_DWORD_STAT(STAT_InteractionTracesBatched);
+		}
+		else
+		{
+			// The target went away while it was queued
+			Character->FinishServerInteractionCheck(Target, false);
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_InteractionChecksDeferred, QueuedCharacters.Num() - NumProcessed);
+
+	// Whoever didn't get a turn stays at the front of the queue
+	QueuedCharacters.RemoveAt(0, NumProcessed, false);
+}
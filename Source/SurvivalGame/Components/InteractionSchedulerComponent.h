@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Player/SurvivalCharacter.h"
+#include "InteractionSchedulerComponent.generated.h"
+
+// An interaction check waiting on its trace
+struct FPendingInteractionCheck
+{
+	TWeakObjectPtr<class ASurvivalCharacter> Character;
+	FInteractionTarget Target;
+	FTraceHandle TraceHandle;
+};
+
+/**
+ * Runs the servers interaction checks for players who pressed interact. Every check asked for in a frame has its trace
+ * issued together as one batch of async traces, and the results are handed back to the players the next frame.
+ * Checks are started in the order they were asked for, within CheckBudgetMicroseconds each frame. Anything over budget
+ * stays at the front of the queue for next frame, so every player gets their turn.
+ * Lives on the game state, and only does anything on the server.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class SURVIVALGAME_API UInteractionSchedulerComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UInteractionSchedulerComponent();
+
+	// Find the interaction scheduler on the worlds game state, if it has one
+	static UInteractionSchedulerComponent* Get(const UObject* WorldContextObject);
+
+	// [server] Trace to the players ServerInteractTarget. The result goes to ASurvivalCharacter::FinishServerInteractionCheck
+	void QueueInteractionCheck(class ASurvivalCharacter* Character);
+
+	// How long starting checks can take each frame, in microseconds
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (ClampMin = 1.0))
+	float CheckBudgetMicroseconds;
+
+	// Checks to start each frame even if they go over budget, so the queue always moves
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (ClampMin = 1))
+	int32 MinChecksPerFrame;
+
+protected:
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Hand last frames trace results back to their players
+	void FinishChecks();
+
+	// Issue each queued players trace to the target they asked for, until the budget runs out
+	void IssueChecks();
+
+	// Players waiting for their check to start, oldest first
+	TArray<TWeakObjectPtr<class ASurvivalCharacter>> QueuedCharacters;
+
+	// Checks whose traces were issued last frame
+	TArray<FPendingInteractionCheck> PendingChecks;
+
+};
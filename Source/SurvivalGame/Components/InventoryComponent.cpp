@@ -2,15 +2,46 @@
 
 
 #include "InventoryComponent.h"
+#include "SurvivalGame.h"
 #include "Net/UnrealNetwork.h"
 #include "Engine/ActorChannel.h"
+#include "Engine/NetConnection.h"
+#include "HAL/IConsoleManager.h"
+#include "Items/EquippableItem.h"
+#include "Player/SurvivalCharacter.h"
 
 #define LOCTEXT_NAMESPACE "Inventory"
 
+DECLARE_CYCLE_STAT(TEXT("Replicate Inventory Items"), STAT_ReplicateInventoryItems, STATGROUP_SurvivalGame);
+// These count the RepKey gating in ReplicateSubobjects. Whether push model then skips a property compare is down to the engine
+DECLARE_DWORD_COUNTER_STAT(TEXT("Item Subobjects Replicated"), STAT_ItemSubobjectsReplicated, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Item Subobjects Unchanged"), STAT_ItemSubobjectsUnchanged, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Inventory Items Deferred"), STAT_InventoryItemsDeferred, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Inventory Items Covered By Snapshot"), STAT_InventoryItemsCoveredBySnapshot, STATGROUP_SurvivalGame);
+
+static TAutoConsoleVariable<int32> CVarInventoryNetBudgetBytes(
+	TEXT("Survival.InventoryNetBudgetBytes"),
+	1024,
+	TEXT("How many bytes of low priority inventory items can be sent to a single connection each net tick. Equipped and hotbar items ignore this."));
+
+// Bits of inventory items written to each connection this frame. Shared by every inventory so opening a big container
+// can't use more than one budget between them
+static uint64 InventoryNetBudgetFrame = 0;
+static TMap<UNetConnection*, int64> InventoryBitsSentThisFrame;
+
 // Sets default values for this component's properties
 UInventoryComponent::UInventoryComponent()
 {
 	SetIsReplicated(true);
+
+	HotbarSize = 5;
+	TrickleItemsPerNetUpdate = 4;
+	VisiblePageStart = 0;
+	VisiblePageSize = 0;
+
+	LastPredictionKey = 0;
+	SentSnapshotVersion = INDEX_NONE;
+	AckedSnapshotVersion = INDEX_NONE;
 }
 
 FItemAddResult UInventoryComponent::TryAddItem(UItem* Item)
@@ -25,10 +56,12 @@ bool UInventoryComponent::RemoveItem(UItem* Item)
 		if (Item)
 		{
 			Items.RemoveSingle(Item);
+			SURVIVAL_MARK_PROPERTY_DIRTY(UInventoryComponent, Items, this);
 
 			OnRep_Items();
 
 			ReplicatedItemsKey++;
+			ResetSnapshotAck();
 
 			return true;
 		}
@@ -36,6 +69,36 @@ bool UInventoryComponent::RemoveItem(UItem* Item)
 	return false;
 }
 
+TArray<UItem*> UInventoryComponent::RemoveAllItems()
+{
+	TArray<UItem*> RemovedItems;
+
+	if (GetOwner() && GetOwner()->HasAuthority())
+	{
+		for (auto& Item : Items)
+		{
+			if (UEquippableItem* EquippableItem = Cast<UEquippableItem>(Item))
+			{
+				if (EquippableItem->IsEquipped())
+				{
+					EquippableItem->SetEquipped(false);
+				}
+			}
+		}
+
+		RemovedItems = MoveTemp(Items);
+		Items.Reset();
+		SURVIVAL_MARK_PROPERTY_DIRTY(UInventoryComponent, Items, this);
+
+		OnRep_Items();
+
+		ReplicatedItemsKey++;
+		ResetSnapshotAck();
+	}
+
+	return RemovedItems;
+}
+
 bool UInventoryComponent::HasItem(TSubclassOf<class UItem> ItemClass, const int32 Quantity) const
 {
 	if (UItem* ItemToFind = FindItemByClass(ItemClass))
@@ -60,6 +123,11 @@ UItem* UInventoryComponent::FindItem(UItem* Item) const
 	return nullptr;
 }
 
+bool UInventoryComponent::ContainsItem(const UItem* Item) const
+{
+	return Item && Items.Contains(Item);
+}
+
 UItem* UInventoryComponent::FindItemByClass(TSubclassOf<class UItem> ItemClass) const
 {
 	for (auto& InvItem : Items)
@@ -162,27 +230,423 @@ void UInventoryComponent::ClientRefreshInventory_Implementation()
 	OnInventoryUpdated.Broadcast();
 }
 
+TArray<UItem*> UInventoryComponent::GetItems() const
+{
+	if (!bUsingSnapshot)
+	{
+		return Items;
+	}
+
+	// The items array itself hasn't arrived yet
+	if (Items.Num() == 0)
+	{
+		return SnapshotItems;
+	}
+
+	// The snapshot lines up with the items array, so fill in whatever hasn't replicated with its stand in
+	TArray<UItem*> MergedItems = Items;
+
+	for (int32 i = 0; i < MergedItems.Num() && i < SnapshotItems.Num(); ++i)
+	{
+		if (!MergedItems[i])
+		{
+			MergedItems[i] = SnapshotItems[i];
+		}
+	}
+
+	return MergedItems;
+}
+
+void UInventoryComponent::SendSnapshot()
+{
+	if (GetOwner() && GetOwner()->HasAuthority())
+	{
+		FInventorySnapshot Snapshot;
+		Snapshot.Version = ReplicatedItemsKey;
+		Snapshot.Entries.Reserve(Items.Num());
+
+		// One entry per slot, even empty ones, so the client can line the snapshot up with the items array
+		for (auto& Item : Items)
+		{
+			FInventorySnapshotEntry& Entry = Snapshot.Entries.AddDefaulted_GetRef();
+
+			if (Item)
+			{
+				Entry.ItemClass = Item->GetClass();
+				Entry.Quantity = Item->GetQuantity();
+
+				if (UEquippableItem* EquippableItem = Cast<UEquippableItem>(Item))
+				{
+					Entry.bEquipped = EquippableItem->IsEquipped();
+				}
+			}
+		}
+
+		SentSnapshotVersion = Snapshot.Version;
+		AckedSnapshotVersion = INDEX_NONE;
+
+		ClientReceiveSnapshot(Snapshot);
+	}
+}
+
+void UInventoryComponent::ClientReceiveSnapshot_Implementation(const FInventorySnapshot& Snapshot)
+{
+	ServerAcknowledgeSnapshot(Snapshot.Version);
+
+	// If the real items beat the snapshot here there is nothing to do
+	if (Items.Num() == Snapshot.Entries.Num() && !Items.Contains(nullptr))
+	{
+		return;
+	}
+
+	ReleaseSnapshot();
+
+	SnapshotItems.Reserve(Snapshot.Entries.Num());
+
+	for (const FInventorySnapshotEntry& Entry : Snapshot.Entries)
+	{
+		UItem* SnapshotItem = nullptr;
+
+		// Equipped items always replicate straight away, so they don't get a stand in. Equipping an object the server
+		// doesn't know about would just have to be undone
+		if (Entry.ItemClass && !Entry.bEquipped)
+		{
+			SnapshotItem = NewObject<UItem>(GetOwner(), Entry.ItemClass);
+			SnapshotItem->Quantity = Entry.Quantity;
+			SnapshotItem->OwningInventory = this;
+			SnapshotItem->bSnapshotStandIn = true;
+		}
+
+		SnapshotItems.Add(SnapshotItem);
+	}
+
+	bUsingSnapshot = true;
+	OnInventoryUpdated.Broadcast();
+}
+
+void UInventoryComponent::ServerAcknowledgeSnapshot_Implementation(const int32 Version)
+{
+	// Ignore acks for a snapshot that has since been invalidated
+	if (Version == SentSnapshotVersion)
+	{
+		AckedSnapshotVersion = Version;
+	}
+}
+
+bool UInventoryComponent::ServerAcknowledgeSnapshot_Validate(const int32 Version)
+{
+	return true;
+}
+
+void UInventoryComponent::ReleaseSnapshot()
+{
+	SnapshotItems.Empty();
+	bUsingSnapshot = false;
+}
+
+void UInventoryComponent::ResetSnapshotAck()
+{
+	SentSnapshotVersion = INDEX_NONE;
+	AckedSnapshotVersion = INDEX_NONE;
+}
+
+void UInventoryComponent::SetVisiblePage(const int32 FirstIndex, const int32 NumItems)
+{
+	if (GetOwner() && !GetOwner()->HasAuthority())
+	{
+		ServerSetVisiblePage(FirstIndex, NumItems);
+	}
+	else
+	{
+		ServerSetVisiblePage_Implementation(FirstIndex, NumItems);
+	}
+}
+
+void UInventoryComponent::ServerSetVisiblePage_Implementation(const int32 FirstIndex, const int32 NumItems)
+{
+	VisiblePageStart = FirstIndex;
+	VisiblePageSize = NumItems;
+}
+
+bool UInventoryComponent::ServerSetVisiblePage_Validate(const int32 FirstIndex, const int32 NumItems)
+{
+	return FirstIndex >= 0 && NumItems >= 0 && NumItems <= 200;
+}
+
+EInventoryNetPriority UInventoryComponent::GetItemNetPriority(const int32 ItemIndex, UItem* Item, const bool bOwnerConnection) const
+{
+	// Everyone needs to see what we're wearing straight away
+	const UEquippableItem* EquippableItem = Cast<UEquippableItem>(Item);
+
+	if (EquippableItem && EquippableItem->IsEquipped())
+	{
+		return EInventoryNetPriority::INP_High;
+	}
+
+	if (bOwnerConnection)
+	{
+		if (ItemIndex < HotbarSize)
+		{
+			return EInventoryNetPriority::INP_High;
+		}
+
+		if (ItemIndex >= VisiblePageStart && ItemIndex < VisiblePageStart + VisiblePageSize)
+		{
+			return EInventoryNetPriority::INP_Visible;
+		}
+	}
+
+	return EInventoryNetPriority::INP_Trickle;
+}
+
+int32 UInventoryComponent::PredictUseItem(UItem* Item)
+{
+	if (GetOwner() && !GetOwner()->HasAuthority() && Item)
+	{
+		// Equipping is the only use that changes the inventory, other items are handled by the server as normal
+		if (UEquippableItem* EquippableItem = Cast<UEquippableItem>(Item))
+		{
+			if (ASurvivalCharacter* Character = Cast<ASurvivalCharacter>(GetOwner()))
+			{
+				FInventoryPrediction Prediction;
+				Prediction.PredictionKey = ++LastPredictionKey;
+				Prediction.Item = Item;
+				Prediction.bTogglesEquipped = true;
+
+				// Mirrors UEquippableItem::Use, which only runs on the server. Like quantities, clients never mark items dirty
+				if (!EquippableItem->IsEquipped())
+				{
+					if (UEquippableItem* AlreadyEquippedItem = Character->GetEquippedItems().FindRef(EquippableItem->Slot))
+					{
+						Prediction.DisplacedItem = AlreadyEquippedItem;
+						AlreadyEquippedItem->SetEquippedLocal(false);
+					}
+				}
+
+				EquippableItem->SetEquippedLocal(!EquippableItem->IsEquipped());
+
+				PendingPredictions.Add(Prediction);
+				OnInventoryUpdated.Broadcast();
+
+				return Prediction.PredictionKey;
+			}
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+int32 UInventoryComponent::PredictQuantityChange(UItem* Item, const int32 QuantityDelta)
+{
+	if (GetOwner() && !GetOwner()->HasAuthority() && Item && QuantityDelta != 0)
+	{
+		// Don't predict more than we actually have, the server will clamp the same way
+		const int32 ClampedDelta = FMath::Max(QuantityDelta, -Item->GetQuantity());
+
+		FInventoryPrediction Prediction;
+		Prediction.PredictionKey = ++LastPredictionKey;
+		Prediction.Item = Item;
+		Prediction.QuantityDelta = ClampedDelta;
+
+		// Write the quantity directly, clients should never mark items dirty for replication
+		Item->Quantity += ClampedDelta;
+		Item->OnItemModified.Broadcast();
+
+		PendingPredictions.Add(Prediction);
+		OnInventoryUpdated.Broadcast();
+
+		return Prediction.PredictionKey;
+	}
+
+	return INDEX_NONE;
+}
+
+void UInventoryComponent::ClientAcknowledgePrediction_Implementation(const int32 PredictionKey, const bool bAccepted)
+{
+	const int32 PredictionIndex = PendingPredictions.IndexOfByPredicate([PredictionKey](const FInventoryPrediction& Prediction)
+	{
+		return Prediction.PredictionKey == PredictionKey;
+	});
+
+	if (PendingPredictions.IsValidIndex(PredictionIndex))
+	{
+		const FInventoryPrediction Prediction = PendingPredictions[PredictionIndex];
+		PendingPredictions.RemoveAt(PredictionIndex);
+
+		// Accepted predictions need no work, the server state that replicates down will match what we applied
+		if (!bAccepted)
+		{
+			RollbackPrediction(Prediction);
+		}
+	}
+}
+
+void UInventoryComponent::ReapplyPredictions(UItem* Item)
+{
+	// The server acknowledges a prediction before the item change it caused replicates, so anything still pending
+	// here hasn't been applied to the quantity we were just sent
+	if (Item)
+	{
+		for (const FInventoryPrediction& Prediction : PendingPredictions)
+		{
+			if (Prediction.Item == Item && Prediction.QuantityDelta != 0)
+			{
+				Item->Quantity = FMath::Max(Item->Quantity + Prediction.QuantityDelta, 0);
+			}
+		}
+	}
+}
+
+void UInventoryComponent::RollbackPrediction(const FInventoryPrediction& Prediction)
+{
+	if (UItem* Item = Prediction.Item)
+	{
+		if (Prediction.QuantityDelta != 0)
+		{
+			Item->Quantity = FMath::Max(Item->Quantity - Prediction.QuantityDelta, 0);
+			Item->OnItemModified.Broadcast();
+		}
+
+		if (Prediction.bTogglesEquipped)
+		{
+			if (UEquippableItem* EquippableItem = Cast<UEquippableItem>(Item))
+			{
+				EquippableItem->SetEquippedLocal(!EquippableItem->IsEquipped());
+			}
+
+			if (Prediction.DisplacedItem)
+			{
+				Prediction.DisplacedItem->SetEquippedLocal(true);
+			}
+		}
+	}
+
+	OnInventoryUpdated.Broadcast();
+}
+
 void UInventoryComponent::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UInventoryComponent, Items);
+	// Only the owner needs to know what is in the inventory. Everyone else just gets the gear they need to see, see ReplicateSubobjects
+	SURVIVAL_DOREPLIFETIME_PUSH_CONDITION(UInventoryComponent, Items, COND_OwnerOnly);
 }
 
 bool UInventoryComponent::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
 {
+	SCOPE_CYCLE_COUNTER(STAT_ReplicateInventoryItems);
+
 	bool bWroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
 
-	// Check if the array of items needs to replicate
-	if (Channel->KeyNeedsToReplicate(0, ReplicatedItemsKey))
+	UNetConnection* Connection = Channel->Connection;
+	const bool bHadDeferredItems = ConnectionsWithDeferredItems.Contains(Connection);
+
+	// Check if the array of items needs to replicate. KeyNeedsToReplicate records the key, so always call it
+	if (Channel->KeyNeedsToReplicate(0, ReplicatedItemsKey) || bHadDeferredItems)
 	{
-		for (auto& Item : Items)
+		if (InventoryNetBudgetFrame != GFrameCounter)
+		{
+			InventoryNetBudgetFrame = GFrameCounter;
+			InventoryBitsSentThisFrame.Reset();
+		}
+
+		int64& BitsSent = InventoryBitsSentThisFrame.FindOrAdd(Connection);
+		const int64 BudgetBits = (int64)FMath::Max(CVarInventoryNetBudgetBytes.GetValueOnGameThread(), 0) * 8;
+		const bool bOwnerConnection = GetOwner() && Connection && GetOwner()->GetNetConnection() == Connection;
+		const bool bCoveredBySnapshot = bOwnerConnection && AckedSnapshotVersion != INDEX_NONE;
+
+		// Send the items in priority order. Items keep their order within a priority
+		TArray<int32, TInlineAllocator<32>> SortedIndices;
+		TArray<EInventoryNetPriority, TInlineAllocator<32>> Priorities;
+		TArray<bool, TInlineAllocator<32>> CoveredBySnapshot;
+		SortedIndices.Reserve(Items.Num());
+		Priorities.Reserve(Items.Num());
+		CoveredBySnapshot.Reserve(Items.Num());
+
+		for (int32 i = 0; i < Items.Num(); ++i)
+		{
+			SortedIndices.Add(i);
+			Priorities.Add(GetItemNetPriority(i, Items[i], bOwnerConnection));
+
+			// The owner can already see this item through its snapshot, so it goes to the back of the trickle queue. It still
+			// has to arrive, the stand in can't be used or dropped
+			const bool bCovered = bCoveredBySnapshot && Items[i] && Priorities[i] == EInventoryNetPriority::INP_Trickle && Items[i]->InventoryVersion <= AckedSnapshotVersion;
+			CoveredBySnapshot.Add(bCovered);
+
+			if (bCovered)
+			{
+				INC_DWORD_STAT(STAT_InventoryItemsCoveredBySnapshot);
+			}
+		}
+
+		SortedIndices.StableSort([&Priorities, &CoveredBySnapshot](const int32 A, const int32 B)
 		{
+			if (Priorities[A] != Priorities[B])
+			{
+				return Priorities[A] < Priorities[B];
+			}
+
+			return !CoveredBySnapshot[A] && CoveredBySnapshot[B];
+		});
+
+		bool bDeferredItems = false;
+		int32 NumTrickled = 0;
+
+		for (const int32 ItemIndex : SortedIndices)
+		{
+			UItem* Item = Items[ItemIndex];
+			const EInventoryNetPriority Priority = Priorities[ItemIndex];
+
+			// Other players only need the items we have equipped, so they can see what we're wearing
+			UEquippableItem* EquippableItem = Cast<UEquippableItem>(Item);
+
+			if (!Item || (!bOwnerConnection && !(EquippableItem && EquippableItem->IsEquipped())))
+			{
+				continue;
+			}
+
+			// Hold back anything below high priority once the budget is spent. Don't check the items key, so it still replicates next time
+			const bool bOverBudget = Priority != EInventoryNetPriority::INP_High && BitsSent >= BudgetBits;
+			const bool bTrickleFull = Priority == EInventoryNetPriority::INP_Trickle && NumTrickled >= TrickleItemsPerNetUpdate;
+
+			if (bOverBudget || bTrickleFull)
+			{
+				INC_DWORD_STAT(STAT_InventoryItemsDeferred);
+				bDeferredItems = true;
+				continue;
+			}
+
 			if (Channel->KeyNeedsToReplicate(Item->GetUniqueID(), Item->RepKey))
 			{
+				INC_DWORD_STAT(STAT_ItemSubobjectsReplicated);
+
+				const int64 BitsBefore = Bunch->GetNumBits();
 				bWroteSomething |= Channel->ReplicateSubobject(Item, *Bunch, *RepFlags);
+				BitsSent += Bunch->GetNumBits() - BitsBefore;
+
+				if (Priority == EInventoryNetPriority::INP_Trickle)
+				{
+					++NumTrickled;
+				}
+			}
+			else
+			{
+				INC_DWORD_STAT(STAT_ItemSubobjectsUnchanged);
 			}
 		}
+
+		if (bDeferredItems)
+		{
+			ConnectionsWithDeferredItems.Add(Connection);
+		}
+		else
+		{
+			ConnectionsWithDeferredItems.Remove(Connection);
+		}
+	}
+	else
+	{
+		INC_DWORD_STAT_BY(STAT_ItemSubobjectsUnchanged, Items.Num());
 	}
 
 	return bWroteSomething;
@@ -198,7 +662,9 @@ UItem* UInventoryComponent::AddItem(UItem* Item)
 		NewItem->OwningInventory = this;
 		NewItem->AddedToInventory(this);
 		Items.Add(NewItem);
+		SURVIVAL_MARK_PROPERTY_DIRTY(UInventoryComponent, Items, this);
 		NewItem->MarkDirtyForReplication();
+		ResetSnapshotAck();
 
 		return NewItem;
 	}
@@ -208,6 +674,21 @@ UItem* UInventoryComponent::AddItem(UItem* Item)
 
 void UInventoryComponent::OnRep_Items()
 {
+	// OwningInventory isn't replicated, so clients set it themselves
+	for (auto& Item : Items)
+	{
+		if (Item)
+		{
+			Item->OwningInventory = this;
+		}
+	}
+
+	// Once every item has arrived the snapshot is no longer needed
+	if (bUsingSnapshot && !Items.Contains(nullptr))
+	{
+		ReleaseSnapshot();
+	}
+
 	OnInventoryUpdated.Broadcast();
 }
 
@@ -69,6 +69,96 @@ struct FItemAddResult
 	}
 };
 
+// How urgently an item in an inventory needs to replicate to a connection
+enum class EInventoryNetPriority : uint8
+{
+	// Equipped items and the owners hotbar. Always sent, regardless of the bandwidth budget
+	INP_High,
+	// Items on the inventory page the owner currently has open
+	INP_Visible,
+	// Everything else, trickled out a few items at a time
+	INP_Trickle
+};
+
+// A change the owning client has made to its inventory before the server has confirmed it
+USTRUCT()
+struct FInventoryPrediction
+{
+	GENERATED_BODY()
+
+	FInventoryPrediction()
+	{
+		PredictionKey = INDEX_NONE;
+		Item = nullptr;
+		QuantityDelta = 0;
+		bTogglesEquipped = false;
+		DisplacedItem = nullptr;
+	}
+
+	// The key the server will acknowledge this prediction with
+	UPROPERTY()
+	int32 PredictionKey;
+
+	// The item the prediction was applied to
+	UPROPERTY()
+	class UItem* Item;
+
+	// How much the predicted action changed the items quantity by
+	UPROPERTY()
+	int32 QuantityDelta;
+
+	// Whether the predicted action equipped or unequipped the item
+	UPROPERTY()
+	bool bTogglesEquipped;
+
+	// The item that was unequipped to make room for Item, if any
+	UPROPERTY()
+	class UEquippableItem* DisplacedItem;
+};
+
+// One item in an inventory snapshot
+USTRUCT()
+struct FInventorySnapshotEntry
+{
+	GENERATED_BODY()
+
+	FInventorySnapshotEntry()
+	{
+		ItemClass = nullptr;
+		Quantity = 0;
+		bEquipped = false;
+	}
+
+	UPROPERTY()
+	TSubclassOf<class UItem> ItemClass;
+
+	UPROPERTY()
+	int32 Quantity;
+
+	UPROPERTY()
+	bool bEquipped;
+};
+
+// The whole contents of an inventory, sent to a joining client in one go so it can use its inventory
+// before every item subobject has replicated
+USTRUCT()
+struct FInventorySnapshot
+{
+	GENERATED_BODY()
+
+	FInventorySnapshot()
+	{
+		Version = 0;
+	}
+
+	// The inventory version the snapshot was taken at. Anything newer than this arrives through normal replication
+	UPROPERTY()
+	int32 Version;
+
+	UPROPERTY()
+	TArray<FInventorySnapshotEntry> Entries;
+};
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class SURVIVALGAME_API UInventoryComponent : public UActorComponent
 {
@@ -93,6 +183,9 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
 	bool RemoveItem(class UItem* Item);
 
+	// [server] Unequip and remove every item in one go, so clients get a single update. Returns the items that were removed
+	TArray<class UItem*> RemoveAllItems();
+
 	// Return true if we have a given amount of an item
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	bool HasItem(TSubclassOf<class UItem> ItemClass, const int32 Quantity = 1) const;
@@ -101,6 +194,10 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	UItem* FindItem(class UItem* Item) const;
 
+	// Return true if this exact item is in the inventory. Use this rather than FindItem when acting on an item a client sent us
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	bool ContainsItem(const class UItem* Item) const;
+
 	// Return the first item with the same class as ItemClass
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	UItem* FindItemByClass(TSubclassOf<class UItem> ItemClass) const;
@@ -124,8 +221,30 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	FORCEINLINE int32 GetCapacity() const { return Capacity; }
 
+	// While a client is waiting on its items to replicate after joining, items that haven't arrived yet are filled in with
+	// read only stand ins from the join snapshot
 	UFUNCTION(BlueprintPure, Category = "Inventory")
-	FORCEINLINE TArray<class UItem*> GetItems() const { return Items; }
+	TArray<class UItem*> GetItems() const;
+
+	// Incremented whenever the items or any item in the inventory changes
+	FORCEINLINE int32 GetVersion() const { return ReplicatedItemsKey; }
+
+	// [server] Send the owning client the full inventory and equipment in a single RPC. Called when a player joins or reconnects
+	void SendSnapshot();
+
+	UFUNCTION(Client, Reliable)
+	void ClientReceiveSnapshot(const FInventorySnapshot& Snapshot);
+
+	// The client has the snapshot, so items that haven't changed since Version are sent after everything else
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerAcknowledgeSnapshot(const int32 Version);
+
+	// Tell the server which items the inventory UI is showing, so they replicate ahead of the rest of the inventory
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void SetVisiblePage(const int32 FirstIndex, const int32 NumItems);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSetVisiblePage(const int32 FirstIndex, const int32 NumItems);
 
 	UFUNCTION(Client, Reliable)
 	void ClientRefreshInventory();
@@ -133,6 +252,19 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "Inventory")
 	FOnInventoryUpdated OnInventoryUpdated;
 
+	// [local] Apply the effect of using an item straight away. Returns the key the server should acknowledge, or INDEX_NONE if nothing was predicted
+	int32 PredictUseItem(class UItem* Item);
+
+	// [local] Change an items quantity straight away, ie when dropping it. Returns the key the server should acknowledge
+	int32 PredictQuantityChange(class UItem* Item, const int32 QuantityDelta);
+
+	// Tells the owning client whether the server accepted a predicted action. Rejected predictions are rolled back
+	UFUNCTION(Client, Reliable)
+	void ClientAcknowledgePrediction(const int32 PredictionKey, const bool bAccepted);
+
+	// [local] Called when the server sends us a new quantity for an item, re-applies any predictions the server hasn't processed yet
+	void ReapplyPredictions(class UItem* Item);
+
 protected:
 
 	// The max weight the inventory can hold
@@ -146,6 +278,20 @@ protected:
 	UPROPERTY(ReplicatedUsing = OnRep_Items, VisibleAnywhere, Category = "Inventory")
 	TArray<class UItem*> Items;
 
+	// The first HotbarSize items are on the owners hotbar, and replicate to the owner before anything else
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory|Replication", meta = (ClampMin = 0))
+	int32 HotbarSize;
+
+	// The most low priority items that can be sent to a connection in one net update
+	UPROPERTY(EditDefaultsOnly, Category = "Inventory|Replication", meta = (ClampMin = 1))
+	int32 TrickleItemsPerNetUpdate;
+
+	// The range of items the owners inventory UI is showing
+	int32 VisiblePageStart;
+	int32 VisiblePageSize;
+
+	EInventoryNetPriority GetItemNetPriority(const int32 ItemIndex, class UItem* Item, const bool bOwnerConnection) const;
+
 	virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
 
@@ -163,4 +309,34 @@ private:
 	// Internal, non-BP exposed add item function
 	FItemAddResult TryAddItem_Internal(class UItem* Item);
 
+	// [local] Throw away the snapshot items once the real items have replicated
+	void ReleaseSnapshot();
+
+	// [local] Items created from the join snapshot. These aren't replicated and only exist until the real items arrive
+	UPROPERTY()
+	TArray<class UItem*> SnapshotItems;
+
+	UPROPERTY()
+	bool bUsingSnapshot;
+
+	// [server] The version of the last snapshot sent to the owner, and the version the owner has confirmed it received
+	int32 SentSnapshotVersion;
+	int32 AckedSnapshotVersion;
+
+	// [server] Items were added or removed, so the snapshot no longer lines up with the items array. Everything replicates as normal again
+	void ResetSnapshotAck();
+
+	// Undo a prediction the server rejected
+	void RollbackPrediction(const FInventoryPrediction& Prediction);
+
+	// Connections that had items held back by the bandwidth budget, and need another pass even if nothing changed
+	TSet<TWeakObjectPtr<class UNetConnection>> ConnectionsWithDeferredItems;
+
+	// Predictions that are waiting on the server, oldest first
+	UPROPERTY()
+	TArray<FInventoryPrediction> PendingPredictions;
+
+	// The last prediction key that was handed out
+	int32 LastPredictionKey;
+
 };
@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LootRespawnComponent.h"
+#include "SurvivalGame.h"
+#include "World/LootSpawnPoint.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/Pawn.h"
+#include "TimerManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Loot Respawns"), STAT_ProcessLootRespawns, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Loot Respawns Run"), STAT_LootRespawnsRun, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Loot Respawns Blocked"), STAT_LootRespawnsBlocked, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Scheduled Loot Respawns"), STAT_ScheduledLootRespawns, STATGROUP_SurvivalGame);
+
+FLootTimingWheel::FLootTimingWheel()
+{
+	Slots.SetNum(NumLevels * NumSlots);
+	CurrentTick = 0;
+	NumScheduled = 0;
+}
+
+void FLootTimingWheel::Schedule(ALootSpawnPoint* SpawnPoint, const uint32 Ticks)
+{
+	// Anything further out than the top level can hold is clamped, which at half a second a tick is about three months
+	const uint32 MaxTicks = (1u << (SlotBits * NumLevels)) - 1;
+
+	FEntry Entry;
+	Entry.SpawnPoint = SpawnPoint;
+	Entry.DueTick = CurrentTick + FMath::Clamp<uint32>(Ticks, 1, MaxTicks);
+
+	Insert(Entry);
+	++NumScheduled;
+}
+
+void FLootTimingWheel::Insert(const FEntry& Entry)
+{
+	// Go up a level for each digit the due tick differs from the current tick in, above the lowest
+	int32 Level = 0;
+
+	while (Level < NumLevels - 1 && (Entry.DueTick >> (SlotBits * (Level + 1))) != (CurrentTick >> (SlotBits * (Level + 1))))
+	{
+		++Level;
+	}
+
+	const int32 Slot = (Entry.DueTick >> (SlotBits * Level)) & (NumSlots - 1);
+	GetSlot(Level, Slot).Add(Entry);
+}
+
+void FLootTimingWheel::Advance(TArray<TWeakObjectPtr<ALootSpawnPoint>>& OutDue)
+{
+	++CurrentTick;
+
+	// Find the highest level that just wrapped round
+	int32 TopLevel = 0;
+
+	while (TopLevel < NumLevels - 1 && (CurrentTick & ((1u << (SlotBits * (TopLevel + 1))) - 1)) == 0)
+	{
+		++TopLevel;
+	}
+
+	// Cascade from the top down, so entries can fall more than one level in the same tick
+	for (int32 Level = TopLevel; Level > 0; --Level)
+	{
+		const int32 Slot = (CurrentTick >> (SlotBits * Level)) & (NumSlots - 1);
+		TArray<FEntry> Cascading = MoveTemp(GetSlot(Level, Slot));
+		GetSlot(Level, Slot).Reset();
+
+		for (const FEntry& Entry : Cascading)
+		{
+			Insert(Entry);
+		}
+	}
+
+	TArray<FEntry>& DueSlot = GetSlot(0, CurrentTick & (NumSlots - 1));
+
+	for (const FEntry& Entry : DueSlot)
+	{
+		OutDue.Add(Entry.SpawnPoint);
+	}
+
+	NumScheduled -= DueSlot.Num();
+	DueSlot.Reset();
+}
+
+ULootRespawnComponent::ULootRespawnComponent()
+{
+	TickInterval = 0.5f;
+	MaxRespawnsPerTick = 16;
+	BlockedRetryDelay = 30.f;
+	LastAdvanceTime = 0.0;
+}
+
+ULootRespawnComponent* ULootRespawnComponent::Get(const UObject* WorldContextObject)
+{
+	if (UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull))
+	{
+		if (AGameStateBase* GameState = World->GetGameState())
+		{
+			return GameState->FindComponentByClass<ULootRespawnComponent>();
+		}
+	}
+
+	return nullptr;
+}
+
+void ULootRespawnComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetOwner()->HasAuthority())
+	{
+		LastAdvanceTime = GetWorld()->GetTimeSeconds();
+		GetWorld()->GetTimerManager().SetTimer(TimerHandle_ProcessRespawns, this, &ULootRespawnComponent::ProcessRespawns, TickInterval, true);
+	}
+}
+
+void ULootRespawnComponent::ScheduleRespawn(ALootSpawnPoint* SpawnPoint, const float Delay)
+{
+	if (GetOwner()->HasAuthority() && SpawnPoint && !SpawnPoint->bRespawnScheduled)
+	{
+		SpawnPoint->bRespawnScheduled = true;
+		TimingWheel.Schedule(SpawnPoint, FMath::CeilToInt(FMath::Max(Delay, 0.f) / TickInterval));
+		INC_DWORD_STAT(STAT_ScheduledLootRespawns);
+	}
+}
+
+void ULootRespawnComponent::ProcessRespawns()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProcessLootRespawns);
+
+	// Timers can fire late, so catch up on any ticks that were missed
+	const double TimeSeconds = GetWorld()->GetTimeSeconds();
+
+	while (TimeSeconds - LastAdvanceTime >= TickInterval)
+	{
+		TimingWheel.Advance(DueSpawnPoints);
+		LastAdvanceTime += TickInterval;
+	}
+
+	if (DueSpawnPoints.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<FVector> PlayerLocations;
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PC = It->Get();
+
+		if (const APawn* Pawn = PC ? PC->GetPawn() : nullptr)
+		{
+			PlayerLocations.Add(Pawn->GetActorLocation());
+		}
+	}
+
+	const int32 NumToProcess = FMath::Min(MaxRespawnsPerTick, DueSpawnPoints.Num());
+
+	for (int32 i = 0; i < NumToProcess; ++i)
+	{
+		DEC_DWORD_STAT(STAT_ScheduledLootRespawns);
+
+		if (ALootSpawnPoint* SpawnPoint = DueSpawnPoints[i].Get())
+		{
+			SpawnPoint->bRespawnScheduled = false;
+
+			if (SpawnPoint->TrySpawnLoot(PlayerLocations))
+			{
+				INC_DWORD_STAT(STAT_LootRespawnsRun);
+			}
+			else
+			{
+				INC_DWORD_STAT(STAT_LootRespawnsBlocked);
+				ScheduleRespawn(SpawnPoint, BlockedRetryDelay);
+			}
+		}
+	}
+
+	DueSpawnPoints.RemoveAt(0, NumToProcess, false);
+}
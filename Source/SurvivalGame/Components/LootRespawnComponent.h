@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "LootRespawnComponent.generated.h"
+
+/**
+ * A hierarchical timing wheel. Each level has 64 slots, and each slot on a level covers 64 slots of the level below.
+ * Scheduling and advancing are constant time no matter how many entries are waiting. Entries in a higher level
+ * cascade down a level each time the level below wraps around, until they land in level 0 and become due.
+ */
+struct FLootTimingWheel
+{
+	static const int32 SlotBits = 6;
+	static const int32 NumSlots = 1 << SlotBits;
+	static const int32 NumLevels = 4;
+
+	FLootTimingWheel();
+
+	// Schedule a spawn point to be due Ticks from now
+	void Schedule(class ALootSpawnPoint* SpawnPoint, const uint32 Ticks);
+
+	// Move forward one tick, adding anything that became due to OutDue
+	void Advance(TArray<TWeakObjectPtr<class ALootSpawnPoint>>& OutDue);
+
+	FORCEINLINE int32 Num() const { return NumScheduled; }
+
+private:
+
+	struct FEntry
+	{
+		TWeakObjectPtr<class ALootSpawnPoint> SpawnPoint;
+		uint32 DueTick;
+	};
+
+	void Insert(const FEntry& Entry);
+
+	TArray<FEntry>& GetSlot(const int32 Level, const int32 Slot) { return Slots[Level * NumSlots + Slot]; }
+
+	TArray<TArray<FEntry>> Slots;
+
+	uint32 CurrentTick;
+	int32 NumScheduled;
+};
+
+/**
+ * Schedules loot spawn point respawns in a timing wheel, so thousands of waiting spawn points cost one timer between them.
+ * Due respawns are processed a batch at a time, and spawn points with players nearby are put back in the wheel to try again later.
+ * Lives on the game state, and only does anything on the server.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class SURVIVALGAME_API ULootRespawnComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULootRespawnComponent();
+
+	// Find the loot respawn component on the worlds game state, if it has one
+	static ULootRespawnComponent* Get(const UObject* WorldContextObject);
+
+	// [server] Spawn loot at a spawn point after Delay seconds
+	void ScheduleRespawn(class ALootSpawnPoint* SpawnPoint, const float Delay);
+
+	// How often the wheel moves forward, in seconds. Respawns happen on these ticks, so this is also how precise they are
+	UPROPERTY(EditDefaultsOnly, Category = "Loot Respawn", meta = (ClampMin = 0.05))
+	float TickInterval;
+
+	// The most respawns to process each tick. Anything past this waits for the next tick
+	UPROPERTY(EditDefaultsOnly, Category = "Loot Respawn", meta = (ClampMin = 1))
+	int32 MaxRespawnsPerTick;
+
+	// How long to wait before trying again when players were too close to a spawn point
+	UPROPERTY(EditDefaultsOnly, Category = "Loot Respawn", meta = (ClampMin = 0.0))
+	float BlockedRetryDelay;
+
+protected:
+
+	virtual void BeginPlay() override;
+
+	void ProcessRespawns();
+
+	FLootTimingWheel TimingWheel;
+
+	// Respawns that are due but haven't been processed yet
+	TArray<TWeakObjectPtr<class ALootSpawnPoint>> DueSpawnPoints;
+
+	// When the wheel last moved forward
+	double LastAdvanceTime;
+
+	FTimerHandle TimerHandle_ProcessRespawns;
+
+};
@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PickupPoolComponent.h"
+#include "SurvivalGame.h"
+#include "World/Pickup.h"
+#include "Components/WorldItemManagerComponent.h"
+#include "Framework/SurvivalReplicationGraph.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "GameFramework/GameStateBase.h"
+#include "TimerManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pickup Spawn"), STAT_PickupSpawn, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Pool Hits"), STAT_PickupPoolHits, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Pool Misses"), STAT_PickupPoolMisses, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Pickups"), STAT_PooledPickups, STATGROUP_SurvivalGame);
+
+UPickupPoolComponent::UPickupPoolComponent()
+{
+	PrewarmPickupClass = nullptr;
+	PrewarmCount = 32;
+	PrewarmPerFrame = 4;
+	MaxPoolSize = 128;
+	NumPrewarmed = 0;
+}
+
+UPickupPoolComponent* UPickupPoolComponent::Get(const UObject* WorldContextObject)
+{
+	if (UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull))
+	{
+		if (AGameStateBase* GameState = World->GetGameState())
+		{
+			return GameState->FindComponentByClass<UPickupPoolComponent>();
+		}
+	}
+
+	return nullptr;
+}
+
+void UPickupPoolComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!PrewarmPickupClass)
+	{
+		if (UWorldItemManagerComponent* WorldItemManager = UWorldItemManagerComponent::Get(this))
+		{
+			PrewarmPickupClass = WorldItemManager->PickupClass;
+		}
+	}
+
+	if (GetOwner()->HasAuthority() && PrewarmPickupClass && PrewarmCount > 0)
+	{
+		GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UPickupPoolComponent::PrewarmStep);
+	}
+}
+
+void UPickupPoolComponent::PrewarmStep()
+{
+	const int32 NumToSpawn = FMath::Min(PrewarmPerFrame, PrewarmCount - NumPrewarmed);
+
+	for (int32 i = 0; i < NumToSpawn; ++i)
+	{
+		if (APickup* Pickup = SpawnPickup(PrewarmPickupClass, GetOwner()->GetActorTransform()))
+		{
+			ReleasePickup(Pickup);
+		}
+
+		++NumPrewarmed;
+	}
+
+	if (NumPrewarmed < PrewarmCount)
+	{
+		GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UPickupPoolComponent::PrewarmStep);
+	}
+}
+
+APickup* UPickupPoolComponent::AcquirePickup(TSubclassOf<APickup> PickupClass, const FTransform& Transform)
+{
+	if (!GetOwner()->HasAuthority() || !PickupClass)
+	{
+		return nullptr;
+	}
+
+	if (FPickupPoolList* Pool = Pools.Find(PickupClass))
+	{
+		while (Pool->FreePickups.Num() > 0)
+		{
+			APickup* Pickup = Pool->FreePickups.Pop(false);
+			DEC_DWORD_STAT(STAT_PooledPickups);
+
+			if (Pickup && !Pickup->IsPendingKillPending())
+			{
+				INC_DWORD_STAT(STAT_PickupPoolHits);
+
+				// Pooled pickups sit where they were released, so their new location has to replicate
+				Pickup->SetReplicateMovement(true);
+				Pickup->SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+				Pickup->SetPooled(false);
+
+				// Pickups sit still on the replication graph, so it needs to know this one has moved cell
+				USurvivalReplicationGraph::RefreshActorRouting(Pickup);
+
+				return Pickup;
+			}
+		}
+	}
+
+	INC_DWORD_STAT(STAT_PickupPoolMisses);
+	return SpawnPickup(PickupClass, Transform);
+}
+
+void UPickupPoolComponent::ReleasePickup(APickup* Pickup)
+{
+	if (!GetOwner()->HasAuthority() || !Pickup || Pickup->IsPendingKillPending() || Pickup->IsPooled())
+	{
+		return;
+	}
+
+	// Level placed pickups are addressed by name on clients that loaded the level, so they can't be reused somewhere else
+	if (Pickup->bNetStartup)
+	{
+		Pickup->Destroy();
+		return;
+	}
+
+	FPickupPoolList& Pool = Pools.FindOrAdd(Pickup->GetClass());
+
+	if (Pool.FreePickups.Num() >= MaxPoolSize)
+	{
+		Pickup->Destroy();
+		return;
+	}
+
+	// The world item manager mustn't keep treating the pickup as the item it used to hold
+	if (UWorldItemManagerComponent* WorldItemManager = UWorldItemManagerComponent::Get(this))
+	{
+		WorldItemManager->ForgetPickup(Pickup);
+	}
+
+	// Movement only replicates to get a reused pickup to its new spot, it doesn't need to while the pickup sits in the pool
+	Pickup->SetReplicateMovement(false);
+	Pickup->SetPooled(true);
+	Pool.FreePickups.Add(Pickup);
+	INC_DWORD_STAT(STAT_PooledPickups);
+}
+
+APickup* UPickupPoolComponent::SpawnPickup(TSubclassOf<APickup> PickupClass, const FTransform& Transform)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PickupSpawn);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.bNoFail = true;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	return GetWorld()->SpawnActor<APickup>(PickupClass, Transform, SpawnParams);
+}
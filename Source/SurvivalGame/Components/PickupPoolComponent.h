@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PickupPoolComponent.generated.h"
+
+// The free pickups of a single pickup class
+USTRUCT()
+struct FPickupPoolList
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<class APickup*> FreePickups;
+};
+
+/**
+ * Keeps a pool of pickup actors so dropping and taking items doesn't spawn and destroy an actor every time.
+ * Pooled pickups are hidden and stay dormant, so they cost nothing on the replication path while they wait to be reused.
+ * Lives on the game state, and only does anything on the server.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class SURVIVALGAME_API UPickupPoolComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPickupPoolComponent();
+
+	// Find the pickup pool on the worlds game state, if it has one
+	static UPickupPoolComponent* Get(const UObject* WorldContextObject);
+
+	// [server] Take a pickup out of the pool, or spawn one if the pool is empty. The pickup still needs initializing
+	class APickup* AcquirePickup(TSubclassOf<class APickup> PickupClass, const FTransform& Transform);
+
+	// [server] Put a pickup back in the pool. Destroys it if the pool is full, or if it was placed in the level
+	void ReleasePickup(class APickup* Pickup);
+
+	// The pickup class to spawn ahead of time. Leave empty to use the world item managers PickupClass, which is what gets acquired
+	UPROPERTY(EditDefaultsOnly, Category = "Pickup Pool")
+	TSubclassOf<class APickup> PrewarmPickupClass;
+
+	// How many pickups to spawn ahead of time
+	UPROPERTY(EditDefaultsOnly, Category = "Pickup Pool", meta = (ClampMin = 0))
+	int32 PrewarmCount;
+
+	// How many pickups to spawn each frame while prewarming, to keep map load from hitching
+	UPROPERTY(EditDefaultsOnly, Category = "Pickup Pool", meta = (ClampMin = 1))
+	int32 PrewarmPerFrame;
+
+	// The most free pickups of any one class the pool will hold on to
+	UPROPERTY(EditDefaultsOnly, Category = "Pickup Pool", meta = (ClampMin = 0))
+	int32 MaxPoolSize;
+
+protected:
+
+	virtual void BeginPlay() override;
+
+	class APickup* SpawnPickup(TSubclassOf<class APickup> PickupClass, const FTransform& Transform);
+
+	void PrewarmStep();
+
+	UPROPERTY()
+	TMap<UClass*, FPickupPoolList> Pools;
+
+	int32 NumPrewarmed;
+
+};
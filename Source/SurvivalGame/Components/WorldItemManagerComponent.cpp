@@ -0,0 +1,850 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WorldItemManagerComponent.h"
+#include "SurvivalGame.h"
+#include "Items/Item.h"
+#include "World/Pickup.h"
+#include "World/WorldItemCell.h"
+#include "Components/PickupPoolComponent.h"
+#include "Framework/SurvivalReplicationGraph.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/Pawn.h"
+#include "TimerManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("World Item Despawn"), STAT_WorldItemDespawn, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dropped Items Despawned"), STAT_DroppedItemsDespawned, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dropped Items Evicted"), STAT_DroppedItemsEvicted, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Dropped World Items"), STAT_DroppedWorldItems, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("World Item Records"), STAT_WorldItemRecords, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("World Items Materialized"), STAT_WorldItemsMaterialized, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("World Items Dematerialized"), STAT_WorldItemsDematerialized, STATGROUP_SurvivalGame);
+
+void FWorldItemHandle::SetPickup(APickup* InPickup)
+{
+	Pickup = InPickup;
+	PickupSerial = InPickup ? InPickup->GetPoolSerial() : INDEX_NONE;
+}
+
+APickup* FWorldItemHandle::GetPickup() const
+{
+	APickup* HandlePickup = Pickup.Get();
+	return HandlePickup && HandlePickup->GetPoolSerial() == PickupSerial && !HandlePickup->IsPooled() ? HandlePickup : nullptr;
+}
+
+// Rarer items are worth more, then newer ones
+struct FMoreValuableCandidate
+{
+	bool operator()(const FDespawnCandidate& A, const FDespawnCandidate& B) const
+	{
+		if (A.Rarity != B.Rarity)
+		{
+			return A.Rarity > B.Rarity;
+		}
+
+		return A.DropTime > B.DropTime;
+	}
+};
+
+struct FLessValuableCandidate
+{
+	bool operator()(const FDespawnCandidate& A, const FDespawnCandidate& B) const
+	{
+		return FMoreValuableCandidate()(B, A);
+	}
+};
+
+UWorldItemManagerComponent::UWorldItemManagerComponent()
+{
+	bInstanceWorldItems = true;
+	bInstanceLevelPickups = true;
+	PickupClass = APickup::StaticClass();
+	CellSize = 5000.f;
+	CellNetCullDistance = 15000.f;
+	DemoteDelay = 30.f;
+	DropMergeRadius = 150.f;
+	DropMergeTime = 60.f;
+	bLazyLevelItems = true;
+	MaterializeRadius = 10000.f;
+	MaterializeItemsPerFrame = 32;
+	DematerializeDelay = 60.f;
+	DespawnTime = 900.f;
+	DespawnPlayerRadius = 3000.f;
+	MaxDroppedItems = 2000;
+	DespawnBudgetMicroseconds = 200.f;
+
+	DespawnPassPickupIndex = 0;
+	DespawnPassCellIndex = 0;
+	DespawnPassEntryIndex = MAX_int32;
+	bDespawnPassRunning = false;
+	DespawnPassCandidateIndex = 0;
+	NumEvictionsToPick = INDEX_NONE;
+	NumValidCandidates = 0;
+	NumDroppedItems = 0;
+
+	// Only ticks on the server, to despawn old drops
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+}
+
+UWorldItemManagerComponent* UWorldItemManagerComponent::Get(const UObject* WorldContextObject)
+{
+	if (UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull))
+	{
+		if (AGameStateBase* GameState = World->GetGameState())
+		{
+			return GameState->FindComponentByClass<UWorldItemManagerComponent>();
+		}
+	}
+
+	return nullptr;
+}
+
+void UWorldItemManagerComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetOwner()->HasAuthority())
+	{
+		GetWorld()->GetTimerManager().SetTimer(TimerHandle_DemoteIdlePickups, this, &UWorldItemManagerComponent::DemoteIdlePickups, FMath::Max(DemoteDelay * 0.5f, 1.f), true);
+		GetWorld()->GetTimerManager().SetTimer(TimerHandle_PruneRecentDrops, this, &UWorldItemManagerComponent::PruneRecentDrops, FMath::Max(DropMergeTime, 1.f), true);
+		GetWorld()->GetTimerManager().SetTimer(TimerHandle_UpdateRelevancy, this, &UWorldItemManagerComponent::UpdateRelevancy, 1.f, true);
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UWorldItemManagerComponent::AddLevelItem(TSubclassOf<UItem> ItemClass, const int32 Quantity, const FTransform& Transform, ALootSpawnPoint* SpawnPoint)
+{
+	if (!GetOwner()->HasAuthority() || !ItemClass || Quantity <= 0)
+	{
+		return;
+	}
+
+	if (!bLazyLevelItems || !bInstanceWorldItems)
+	{
+		AddWorldItem(ItemClass, Quantity, Transform, -1.f, SpawnPoint);
+		return;
+	}
+
+	FWorldItemRecord& Record = Records.FindOrAdd(GetCellCoord(Transform.GetLocation())).AddDefaulted_GetRef();
+	Record.ItemClass = ItemClass;
+	Record.Quantity = Quantity;
+	Record.Transform = Transform;
+	Record.SpawnPoint = SpawnPoint;
+
+	INC_DWORD_STAT(STAT_WorldItemRecords);
+}
+
+void UWorldItemManagerComponent::GatherPlayerLocations()
+{
+	PlayerLocations.Reset();
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PC = It->Get();
+
+		if (const APawn* Pawn = PC ? PC->GetPawn() : nullptr)
+		{
+			PlayerLocations.Add(Pawn->GetActorLocation());
+		}
+	}
+}
+
+void UWorldItemManagerComponent::UpdateRelevancy()
+{
+	GatherPlayerLocations();
+
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+	const int32 CellRadius = FMath::CeilToInt(MaterializeRadius / CellSize);
+
+	// Mark every cell around a player as relevant, and queue up any records in them
+	for (const FVector& PlayerLocation : PlayerLocations)
+	{
+		const FIntVector PlayerCoord = GetCellCoord(PlayerLocation);
+
+		for (int32 X = -CellRadius; X <= CellRadius; ++X)
+		{
+			for (int32 Y = -CellRadius; Y <= CellRadius; ++Y)
+			{
+				const FIntVector CellCoord = PlayerCoord + FIntVector(X, Y, 0);
+
+				CellRelevantTimes.Add(CellCoord, TimeSeconds);
+
+				if (Records.Contains(CellCoord))
+				{
+					MaterializeQueue.AddUnique(CellCoord);
+				}
+			}
+		}
+	}
+
+	for (auto It = Cells.CreateIterator(); It; ++It)
+	{
+		const float* RelevantTime = CellRelevantTimes.Find(It.Key());
+
+		if (!It.Value() || It.Value()->IsPendingKill())
+		{
+			It.RemoveCurrent();
+		}
+		else if (!RelevantTime || TimeSeconds - *RelevantTime > DematerializeDelay)
+		{
+			DematerializeCell(It.Key(), It.Value());
+
+			if (!It.Value() || It.Value()->IsPendingKill())
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+
+	// Forget about cells that nothing is in any more
+	for (auto It = CellRelevantTimes.CreateIterator(); It; ++It)
+	{
+		if (TimeSeconds - It.Value() > DematerializeDelay && !Cells.Contains(It.Key()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UWorldItemManagerComponent::MaterializeQueuedRecords()
+{
+	int32 NumMaterialized = 0;
+
+	while (MaterializeQueue.Num() > 0 && NumMaterialized < MaterializeItemsPerFrame)
+	{
+		const FIntVector CellCoord = MaterializeQueue.Last();
+		TArray<FWorldItemRecord>* CellRecords = Records.Find(CellCoord);
+
+		while (CellRecords && CellRecords->Num() > 0 && NumMaterialized < MaterializeItemsPerFrame)
+		{
+			const FWorldItemRecord Record = CellRecords->Pop(false);
+			AddWorldItem(Record.ItemClass, Record.Quantity, Record.Transform, -1.f, Record.SpawnPoint.Get());
+
+			++NumMaterialized;
+			INC_DWORD_STAT(STAT_WorldItemsMaterialized);
+			DEC_DWORD_STAT(STAT_WorldItemRecords);
+		}
+
+		if (!CellRecords || CellRecords->Num() == 0)
+		{
+			Records.Remove(CellCoord);
+			MaterializeQueue.Pop(false);
+		}
+	}
+}
+
+void UWorldItemManagerComponent::DematerializeCell(const FIntVector& CellCoord, AWorldItemCell* Cell)
+{
+	if (!bLazyLevelItems)
+	{
+		return;
+	}
+
+	// Dropped items stay where they are, the despawn pass takes care of them
+	for (int32 i = Cell->GetNumItems() - 1; i >= 0; --i)
+	{
+		const FWorldItemEntry& Entry = Cell->GetItems()[i];
+
+		if (Entry.DropTime < 0.f)
+		{
+			FWorldItemEntry RemovedEntry;
+
+			if (Cell->RemoveItem(Entry.ItemId, RemovedEntry))
+			{
+				FWorldItemRecord& Record = Records.FindOrAdd(CellCoord).AddDefaulted_GetRef();
+				Record.ItemClass = RemovedEntry.ItemClass;
+				Record.Quantity = RemovedEntry.Quantity;
+				Record.Transform = RemovedEntry.GetTransform();
+				Record.SpawnPoint = RemovedEntry.SpawnPoint;
+
+				INC_DWORD_STAT(STAT_WorldItemsDematerialized);
+				INC_DWORD_STAT(STAT_WorldItemRecords);
+			}
+		}
+	}
+
+	if (Cell->GetNumItems() == 0)
+	{
+		Cell->Destroy();
+	}
+}
+
+void UWorldItemManagerComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	MaterializeQueuedRecords();
+
+	SCOPE_CYCLE_COUNTER(STAT_WorldItemDespawn);
+
+	const double EndTime = FPlatformTime::Seconds() + DespawnBudgetMicroseconds / 1000000.0;
+
+	// Evictions go first, they are what keeps the number of dropped items under the cap
+	if (!EvictDroppedItems(GetEvictionTargetCount(), EndTime))
+	{
+		return;
+	}
+
+	if (!bDespawnPassRunning)
+	{
+		BeginDespawnPass();
+	}
+
+	GatherPlayerLocations();
+
+	// Checking the time is cheap, but not free, so only do it every few items
+	const int32 ItemsPerTimeCheck = 16;
+	int32 NumChecked = 0;
+
+	while (DespawnPassPickupIndex < DespawnPassPickups.Num())
+	{
+		CheckDroppedPickup(DespawnPassPickups[DespawnPassPickupIndex++].Get());
+
+		if (++NumChecked % ItemsPerTimeCheck == 0 && FPlatformTime::Seconds() >= EndTime)
+		{
+			return;
+		}
+	}
+
+	while (DespawnPassCellIndex < DespawnPassCells.Num())
+	{
+		if (AWorldItemCell* Cell = DespawnPassCells[DespawnPassCellIndex].Get())
+		{
+			// Go backwards, so removing an item doesn't move the ones we haven't checked yet. The cell may have shrunk since last frame
+			DespawnPassEntryIndex = FMath::Min(DespawnPassEntryIndex, Cell->GetNumItems() - 1);
+
+			while (DespawnPassEntryIndex >= 0)
+			{
+				const FWorldItemEntry& Entry = Cell->GetItems()[DespawnPassEntryIndex--];
+
+				if (Entry.DropTime >= 0.f)
+				{
+					FWorldItemHandle Handle;
+					Handle.Cell = Cell;
+					Handle.ItemId = Entry.ItemId;
+
+					CheckDroppedItem(Handle, Entry.ItemClass, Entry.DropTime, Entry.Location);
+				}
+
+				if (++NumChecked % ItemsPerTimeCheck == 0 && FPlatformTime::Seconds() >= EndTime)
+				{
+					return;
+				}
+			}
+		}
+
+		++DespawnPassCellIndex;
+		DespawnPassEntryIndex = MAX_int32;
+	}
+
+	// Every item has been checked, so work out which are least valuable, also a few at a time
+	if (NumEvictionsToPick == INDEX_NONE)
+	{
+		// Pick enough to get down to the target, plus a reserve for drops that go over the cap before the next pass
+		const int32 TargetCount = GetEvictionTargetCount();
+		const int32 ReserveCount = MaxDroppedItems - TargetCount;
+
+		NumEvictionsToPick = DespawnCandidates.Num() > TargetCount ? FMath::Min(DespawnCandidates.Num() - TargetCount + ReserveCount, DespawnCandidates.Num()) : 0;
+		EvictionHeap.Reset(NumEvictionsToPick);
+	}
+
+	while (DespawnPassCandidateIndex < DespawnCandidates.Num())
+	{
+		AddEvictionCandidate(DespawnCandidates[DespawnPassCandidateIndex++]);
+
+		if (++NumChecked % ItemsPerTimeCheck == 0 && FPlatformTime::Seconds() >= EndTime)
+		{
+			return;
+		}
+	}
+
+	FinishDespawnPass();
+}
+
+void UWorldItemManagerComponent::BeginDespawnPass()
+{
+	DroppedPickups.RemoveAllSwap([](const TWeakObjectPtr<APickup>& Pickup)
+	{
+		return !Pickup.IsValid() || Pickup->IsPooled();
+	});
+
+	DespawnPassPickups = DroppedPickups;
+
+	for (const auto& PromotedPickup : PromotedPickups)
+	{
+		if (PromotedPickup.Key)
+		{
+			DespawnPassPickups.Add(PromotedPickup.Key);
+		}
+	}
+
+	DespawnPassCells.Reset(Cells.Num());
+
+	for (const auto& CellPair : Cells)
+	{
+		if (CellPair.Value)
+		{
+			DespawnPassCells.Add(CellPair.Value);
+		}
+	}
+
+	DespawnPassPickupIndex = 0;
+	DespawnPassCellIndex = 0;
+	DespawnPassEntryIndex = MAX_int32;
+	DespawnPassCandidateIndex = 0;
+	NumEvictionsToPick = INDEX_NONE;
+	NumValidCandidates = 0;
+	DespawnCandidates.Reset();
+	bDespawnPassRunning = true;
+}
+
+void UWorldItemManagerComponent::CheckDroppedPickup(APickup* Pickup)
+{
+	if (Pickup && !Pickup->IsPendingKillPending() && !Pickup->IsPooled() && Pickup->DropTime >= 0.f)
+	{
+		FWorldItemHandle Handle;
+		Handle.SetPickup(Pickup);
+
+		CheckDroppedItem(Handle, Pickup->GetItemClass(), Pickup->DropTime, Pickup->GetActorLocation());
+	}
+}
+
+bool UWorldItemManagerComponent::CheckDroppedItem(const FWorldItemHandle& Handle, TSubclassOf<UItem> ItemClass, const float ItemDropTime, const FVector& Location)
+{
+	const UItem* ItemCDO = ItemClass ? ItemClass->GetDefaultObject<UItem>() : nullptr;
+
+	if (!ItemCDO)
+	{
+		return false;
+	}
+
+	const bool bExpired = DespawnTime > 0.f && GetWorld()->GetTimeSeconds() - ItemDropTime > DespawnTime;
+
+	if (bExpired && !IsPlayerNear(Location) && DespawnItem(Handle))
+	{
+		INC_DWORD_STAT(STAT_DroppedItemsDespawned);
+		return true;
+	}
+
+	FDespawnCandidate& Candidate = DespawnCandidates.AddDefaulted_GetRef();
+	Candidate.Handle = Handle;
+	Candidate.Rarity = ItemCDO->Rarity;
+	Candidate.DropTime = ItemDropTime;
+
+	return false;
+}
+
+void UWorldItemManagerComponent::AddEvictionCandidate(const FDespawnCandidate& Candidate)
+{
+	// Items can be taken or despawned while the pass is still running
+	if (!IsHandleValid(Candidate.Handle))
+	{
+		return;
+	}
+
+	++NumValidCandidates;
+
+	if (NumEvictionsToPick <= 0)
+	{
+		return;
+	}
+
+	// Only the least valuable items need ordering, so keep them in a heap with the most valuable on top instead of
+	// sorting every dropped item
+	if (EvictionHeap.Num() < NumEvictionsToPick)
+	{
+		EvictionHeap.HeapPush(Candidate, FMoreValuableCandidate());
+	}
+	else if (FMoreValuableCandidate()(EvictionHeap.HeapTop(), Candidate))
+	{
+		EvictionHeap.HeapPopDiscard(FMoreValuableCandidate(), false);
+		EvictionHeap.HeapPush(Candidate, FMoreValuableCandidate());
+	}
+}
+
+void UWorldItemManagerComponent::FinishDespawnPass()
+{
+	bDespawnPassRunning = false;
+
+	// Drops made in cells the pass had already been through are missed until the next pass, which is close enough
+	NumDroppedItems = NumValidCandidates;
+	SET_DWORD_STAT(STAT_DroppedWorldItems, NumDroppedItems);
+
+	// Flip the heap over so the least valuable is on top. Heapifying is linear, and each eviction pays for its own pop
+	PendingEvictions = MoveTemp(EvictionHeap);
+	PendingEvictions.Heapify(FLessValuableCandidate());
+
+	DespawnCandidates.Reset();
+}
+
+bool UWorldItemManagerComponent::DespawnItem(const FWorldItemHandle& Handle)
+{
+	if (AWorldItemCell* Cell = Handle.Cell.Get())
+	{
+		FWorldItemEntry Entry;
+
+		if (Cell->RemoveItem(Handle.ItemId, Entry))
+		{
+			NumDroppedItems = FMath::Max(NumDroppedItems - 1, 0);
+			return true;
+		}
+
+		return false;
+	}
+
+	// Don't pull a pickup out from under somebody taking it. A pickup that was taken and handed out again is a different item now
+	APickup* Pickup = Handle.GetPickup();
+
+	if (Pickup && !Pickup->IsPendingKillPending() && !Pickup->IsInUse())
+	{
+		PromotedPickups.Remove(Pickup);
+		Pickup->ReleaseOrDestroy();
+		NumDroppedItems = FMath::Max(NumDroppedItems - 1, 0);
+		return true;
+	}
+
+	return false;
+}
+
+bool UWorldItemManagerComponent::IsHandleValid(const FWorldItemHandle& Handle) const
+{
+	if (const AWorldItemCell* Cell = Handle.Cell.Get())
+	{
+		return Cell->FindItem(Handle.ItemId) != nullptr;
+	}
+
+	const APickup* Pickup = Handle.GetPickup();
+	return Pickup && !Pickup->IsPendingKillPending();
+}
+
+bool UWorldItemManagerComponent::EvictDroppedItems(const int32 TargetCount, const double EndTime)
+{
+	while (NumDroppedItems > TargetCount && PendingEvictions.Num() > 0)
+	{
+		FDespawnCandidate Eviction;
+		PendingEvictions.HeapPop(Eviction, FLessValuableCandidate(), false);
+
+		// Evictions that were taken or despawned since they were picked just fall through to the next one
+		if (DespawnItem(Eviction.Handle))
+		{
+			INC_DWORD_STAT(STAT_DroppedItemsEvicted);
+		}
+
+		if (FPlatformTime::Seconds() >= EndTime)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int32 UWorldItemManagerComponent::GetEvictionTargetCount() const
+{
+	return MaxDroppedItems - FMath::Max(MaxDroppedItems / 10, 1);
+}
+
+bool UWorldItemManagerComponent::IsPlayerNear(const FVector& Location) const
+{
+	const float RadiusSquared = FMath::Square(DespawnPlayerRadius);
+
+	for (const FVector& PlayerLocation : PlayerLocations)
+	{
+		if (FVector::DistSquared(PlayerLocation, Location) < RadiusSquared)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+FWorldItemHandle UWorldItemManagerComponent::AddWorldItem(TSubclassOf<UItem> ItemClass, const int32 Quantity, const FTransform& Transform, const float DropTime, ALootSpawnPoint* SpawnPoint, TSubclassOf<APickup> ItemPickupClass)
+{
+	FWorldItemHandle Handle;
+
+	if (!GetOwner()->HasAuthority() || !ItemClass || Quantity <= 0)
+	{
+		return Handle;
+	}
+
+	if (!bInstanceWorldItems || (ItemPickupClass && ItemPickupClass != PickupClass))
+	{
+		Handle.SetPickup(SpawnPickup(ItemClass, Quantity, Transform, ItemPickupClass));
+
+		if (Handle.Pickup.IsValid())
+		{
+			Handle.Pickup->SpawnPoint = SpawnPoint;
+		}
+
+		if (Handle.Pickup.IsValid() && DropTime >= 0.f)
+		{
+			Handle.Pickup->DropTime = DropTime;
+			DroppedPickups.Add(Handle.Pickup);
+		}
+
+		return Handle;
+	}
+
+	if (AWorldItemCell* Cell = GetOrCreateCell(Transform.GetLocation()))
+	{
+		Handle.Cell = Cell;
+		Handle.ItemId = Cell->AddItem(ItemClass, Quantity, Transform, DropTime, SpawnPoint);
+	}
+
+	return Handle;
+}
+
+void UWorldItemManagerComponent::DropWorldItem(TSubclassOf<UItem> ItemClass, const int32 Quantity, const FTransform& Transform, TSubclassOf<APickup> ItemPickupClass)
+{
+	if (!GetOwner()->HasAuthority() || !ItemClass || Quantity <= 0)
+	{
+		return;
+	}
+
+	if (!ItemPickupClass)
+	{
+		ItemPickupClass = PickupClass;
+	}
+
+	const int32 RemainingQuantity = MergeIntoRecentDrops(ItemClass, Quantity, Transform.GetLocation(), ItemPickupClass);
+
+	if (RemainingQuantity > 0)
+	{
+		FRecentDrop Drop;
+		Drop.ItemClass = ItemClass;
+		Drop.Location = Transform.GetLocation();
+		Drop.DropTime = GetWorld()->GetTimeSeconds();
+		Drop.Handle = AddWorldItem(ItemClass, RemainingQuantity, Transform, Drop.DropTime, nullptr, ItemPickupClass);
+
+		if (IsHandleValid(Drop.Handle))
+		{
+			++NumDroppedItems;
+
+			// Don't wait for the next pass to get back under the cap. Only the cap is enforced here, the tick evicts the rest
+			EvictDroppedItems(MaxDroppedItems, MAX_dbl);
+		}
+
+		if (ItemClass->GetDefaultObject<UItem>()->bStackable)
+		{
+			RecentDrops.Add(GetMergeCoord(Drop.Location), Drop);
+		}
+	}
+}
+
+int32 UWorldItemManagerComponent::MergeIntoRecentDrops(TSubclassOf<UItem> ItemClass, const int32 Quantity, const FVector& Location, TSubclassOf<APickup> ItemPickupClass)
+{
+	const UItem* ItemCDO = ItemClass->GetDefaultObject<UItem>();
+
+	if (!ItemCDO->bStackable || DropMergeRadius <= 0.f)
+	{
+		return Quantity;
+	}
+
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+	const FIntVector MergeCoord = GetMergeCoord(Location);
+	int32 RemainingQuantity = Quantity;
+
+	// Hash cells are as wide as the merge radius, so only the neighbouring cells can hold drops in range
+	for (int32 X = -1; X <= 1 && RemainingQuantity > 0; ++X)
+	{
+		for (int32 Y = -1; Y <= 1 && RemainingQuantity > 0; ++Y)
+		{
+			TArray<FRecentDrop*, TInlineAllocator<8>> Drops;
+			RecentDrops.MultiFindPointer(MergeCoord + FIntVector(X, Y, 0), Drops);
+
+			for (FRecentDrop* Drop : Drops)
+			{
+				if (RemainingQuantity <= 0)
+				{
+					break;
+				}
+
+				if (Drop->ItemClass != ItemClass || TimeSeconds - Drop->DropTime > DropMergeTime || FVector::DistSquared(Drop->Location, Location) > FMath::Square(DropMergeRadius))
+				{
+					continue;
+				}
+
+				// Cell items are promoted to our PickupClass, so only drops that want that can go into them
+				if (AWorldItemCell* Cell = Drop->Handle.Cell.Get())
+				{
+					const FWorldItemEntry* Entry = ItemPickupClass == PickupClass ? Cell->FindItem(Drop->Handle.ItemId) : nullptr;
+
+					if (Entry)
+					{
+						const int32 MergeAmount = FMath::Min(RemainingQuantity, ItemCDO->MaxStackSize - Entry->Quantity);
+
+						if (MergeAmount > 0 && Cell->SetItemQuantity(Drop->Handle.ItemId, Entry->Quantity + MergeAmount))
+						{
+							RemainingQuantity -= MergeAmount;
+						}
+					}
+				}
+				else if (APickup* Pickup = Drop->Handle.GetPickup())
+				{
+					const int32 MergeAmount = FMath::Min(RemainingQuantity, ItemCDO->MaxStackSize - Pickup->GetQuantity());
+
+					// Check where the pickup actually is, not where it was dropped. Pooled pickups get reused elsewhere
+					const bool bPickupInRange = FVector::DistSquared(Pickup->GetActorLocation(), Location) <= FMath::Square(DropMergeRadius);
+
+					if (MergeAmount > 0 && bPickupInRange && !Pickup->IsPendingKillPending() && Pickup->GetItemClass() == ItemClass && Pickup->GetClass() == ItemPickupClass)
+					{
+						Pickup->SetQuantity(Pickup->GetQuantity() + MergeAmount);
+						RemainingQuantity -= MergeAmount;
+					}
+				}
+			}
+		}
+	}
+
+	return RemainingQuantity;
+}
+
+FIntVector UWorldItemManagerComponent::GetMergeCoord(const FVector& Location) const
+{
+	const float HashSize = FMath::Max(DropMergeRadius, 1.f);
+	return FIntVector(FMath::FloorToInt(Location.X / HashSize), FMath::FloorToInt(Location.Y / HashSize), 0);
+}
+
+void UWorldItemManagerComponent::ForgetPickup(APickup* Pickup)
+{
+	for (auto It = RecentDrops.CreateIterator(); It; ++It)
+	{
+		if (It.Value().Handle.Pickup == Pickup)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UWorldItemManagerComponent::OnDroppedItemTaken()
+{
+	NumDroppedItems = FMath::Max(NumDroppedItems - 1, 0);
+}
+
+void UWorldItemManagerComponent::PruneRecentDrops()
+{
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+
+	for (auto It = RecentDrops.CreateIterator(); It; ++It)
+	{
+		const FRecentDrop& Drop = It.Value();
+
+		if (TimeSeconds - Drop.DropTime > DropMergeTime || (!Drop.Handle.Cell.IsValid() && !Drop.Handle.GetPickup()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+APickup* UWorldItemManagerComponent::PromoteWorldItem(AWorldItemCell* Cell, const int32 ItemId)
+{
+	FWorldItemEntry Entry;
+
+	if (GetOwner()->HasAuthority() && Cell && Cell->RemoveItem(ItemId, Entry))
+	{
+		if (APickup* Pickup = SpawnPickup(Entry.ItemClass, Entry.Quantity, Entry.GetTransform()))
+		{
+			Pickup->DropTime = Entry.DropTime;
+			Pickup->SpawnPoint = Entry.SpawnPoint;
+			PromotedPickups.Add(Pickup, GetWorld()->GetTimeSeconds());
+			return Pickup;
+		}
+	}
+
+	return nullptr;
+}
+
+APickup* UWorldItemManagerComponent::SpawnPickup(TSubclassOf<UItem> ItemClass, const int32 Quantity, const FTransform& Transform, TSubclassOf<APickup> ItemPickupClass)
+{
+	if (!GetOwner()->HasAuthority() || !ItemClass || Quantity <= 0)
+	{
+		return nullptr;
+	}
+
+	const TSubclassOf<APickup> SpawnClass = ItemPickupClass ? ItemPickupClass : PickupClass;
+
+	ensure(SpawnClass);
+
+	APickup* Pickup = nullptr;
+
+	if (UPickupPoolComponent* PickupPool = UPickupPoolComponent::Get(this))
+	{
+		Pickup = PickupPool->AcquirePickup(SpawnClass, Transform);
+	}
+	else
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.bNoFail = true;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+		Pickup = GetWorld()->SpawnActor<APickup>(SpawnClass, Transform, SpawnParams);
+	}
+
+	Pickup->InitializePickup(ItemClass, Quantity);
+
+	return Pickup;
+}
+
+AWorldItemCell* UWorldItemManagerComponent::GetOrCreateCell(const FVector& Location)
+{
+	const FIntVector CellCoord = GetCellCoord(Location);
+
+	AWorldItemCell*& Cell = Cells.FindOrAdd(CellCoord);
+
+	if (!Cell || Cell->IsPendingKill())
+	{
+		// Put the cell in the middle of its area so distance based relevancy works from the cells location
+		const FVector CellCenter((CellCoord.X + 0.5f) * CellSize, (CellCoord.Y + 0.5f) * CellSize, Location.Z);
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		Cell = GetWorld()->SpawnActor<AWorldItemCell>(AWorldItemCell::StaticClass(), CellCenter, FRotator::ZeroRotator, SpawnParams);
+		Cell->CellCoord = CellCoord;
+		Cell->NetCullDistanceSquared = FMath::Square(CellNetCullDistance);
+		USurvivalReplicationGraph::RefreshActorRouting(Cell);
+	}
+
+	return Cell;
+}
+
+FIntVector UWorldItemManagerComponent::GetCellCoord(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), 0);
+}
+
+void UWorldItemManagerComponent::DemoteIdlePickups()
+{
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+
+	for (auto It = PromotedPickups.CreateIterator(); It; ++It)
+	{
+		APickup* Pickup = It.Key();
+
+		// Pickups that have been taken are gone already
+		if (!Pickup || Pickup->IsPendingKillPending() || Pickup->IsPooled() || !Pickup->GetItemClass())
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		// Don't pull a pickup out from under a player who is looking at it or using it
+		if (Pickup->IsInUse() || Pickup->CouldBeFocused())
+		{
+			It.Value() = TimeSeconds;
+			continue;
+		}
+
+		if (TimeSeconds - It.Value() > DemoteDelay)
+		{
+			AddWorldItem(Pickup->GetItemClass(), Pickup->GetQuantity(), Pickup->GetActorTransform(), Pickup->DropTime, Pickup->SpawnPoint.Get());
+			Pickup->ReleaseOrDestroy();
+			It.RemoveCurrent();
+		}
+	}
+}
@@ -0,0 +1,275 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "WorldItemManagerComponent.generated.h"
+
+enum class EItemRarity : uint8;
+
+// Refers to an item the manager has put into the world, either as an instanced cell entry or as a pickup actor
+struct FWorldItemHandle
+{
+	FWorldItemHandle()
+		: ItemId(INDEX_NONE), PickupSerial(INDEX_NONE)
+	{}
+
+	TWeakObjectPtr<class AWorldItemCell> Cell;
+	int32 ItemId;
+	TWeakObjectPtr<class APickup> Pickup;
+
+	// The pickups pool serial when the handle was made. Once the pickup has been pooled the handle no longer refers to it
+	int32 PickupSerial;
+
+	void SetPickup(class APickup* InPickup);
+
+	// The pickup, as long as it hasn't been pooled and handed out again since the handle was made
+	class APickup* GetPickup() const;
+};
+
+// An item dropped recently enough that new drops of the same item can be merged into it
+struct FRecentDrop
+{
+	FWorldItemHandle Handle;
+	TSubclassOf<class UItem> ItemClass;
+	FVector Location;
+	float DropTime;
+};
+
+// A level placed item nobody has been near yet. Kept on the server only, until a player comes close enough for it to be put into a cell
+struct FWorldItemRecord
+{
+	TSubclassOf<class UItem> ItemClass;
+	int32 Quantity;
+	FTransform Transform;
+	TWeakObjectPtr<class ALootSpawnPoint> SpawnPoint;
+};
+
+// A dropped item the despawn pass has found, which may be evicted if there are too many dropped items
+struct FDespawnCandidate
+{
+	FWorldItemHandle Handle;
+	EItemRarity Rarity;
+	float DropTime;
+};
+
+/**
+ * Keeps items lying in the world as lightweight entries inside a grid of AWorldItemCell actors, instead of one APickup actor per item.
+ * An item is only promoted to a full APickup when a player focuses on it, and demoted again once it has been left alone.
+ * Level placed items are kept as records on the server until a player comes near, and go back to being records once
+ * the area has been empty for a while.
+ * Dropped items are despawned once they are old and nobody is around, and the oldest least valuable drops are evicted
+ * when there are too many. This is done a few items at a time across frames, within DespawnBudgetMicroseconds. Each pass
+ * also picks a reserve of the least valuable drops, so a drop that takes us over MaxDroppedItems can evict one straight away.
+ * Lives on the game state, and only does anything on the server.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class SURVIVALGAME_API UWorldItemManagerComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UWorldItemManagerComponent();
+
+	// Find the world item manager on the worlds game state, if it has one
+	static UWorldItemManagerComponent* Get(const UObject* WorldContextObject);
+
+	// [server] Put an item into the world. Items with a DropTime are despawned once they get old, level placed items pass -1.
+	// Items from a loot spawn point tell it when they have been taken. Items that need a pickup class other than our
+	// PickupClass always get their own pickup actor, since cells can't remember which class to promote them to
+	FWorldItemHandle AddWorldItem(TSubclassOf<class UItem> ItemClass, const int32 Quantity, const FTransform& Transform, const float DropTime = -1.f, class ALootSpawnPoint* SpawnPoint = nullptr, TSubclassOf<class APickup> ItemPickupClass = nullptr);
+
+	// [server] Put a level placed item into the world. It won't be put into a cell until a player comes within MaterializeRadius
+	void AddLevelItem(TSubclassOf<class UItem> ItemClass, const int32 Quantity, const FTransform& Transform, class ALootSpawnPoint* SpawnPoint = nullptr);
+
+	// [server] Put an item a player dropped into the world. Stackable items are merged into identical drops nearby where possible.
+	// ItemPickupClass is the pickup the dropper wants, or null for our PickupClass
+	void DropWorldItem(TSubclassOf<class UItem> ItemClass, const int32 Quantity, const FTransform& Transform, TSubclassOf<class APickup> ItemPickupClass = nullptr);
+
+	// [server] Swap an instanced world item for a full pickup actor, so it can be interacted with
+	class APickup* PromoteWorldItem(class AWorldItemCell* Cell, const int32 ItemId);
+
+	// [server] Spawn a full pickup actor for an item, using our PickupClass unless ItemPickupClass is given
+	class APickup* SpawnPickup(TSubclassOf<class UItem> ItemClass, const int32 Quantity, const FTransform& Transform, TSubclassOf<class APickup> ItemPickupClass = nullptr);
+
+	// [server] Called when a pickup goes back into the pickup pool. It may be reused for another item anywhere on the map,
+	// so nothing should be merged into it any more
+	void ForgetPickup(class APickup* Pickup);
+
+	// [server] Called when a player takes all of a dropped item, so the dropped item count stays right between despawn passes
+	void OnDroppedItemTaken();
+
+	// If false every world item gets its own pickup actor, as it did before the manager existed
+	UPROPERTY(EditDefaultsOnly, Category = "World Items")
+	bool bInstanceWorldItems;
+
+	// Whether pickups placed in the level are turned into instanced world items when the game starts
+	UPROPERTY(EditDefaultsOnly, Category = "World Items")
+	bool bInstanceLevelPickups;
+
+	// The pickup actor to spawn when an item is promoted
+	UPROPERTY(EditDefaultsOnly, Category = "World Items")
+	TSubclassOf<class APickup> PickupClass;
+
+	// The width of each cell in the world item grid
+	UPROPERTY(EditDefaultsOnly, Category = "World Items", meta = (ClampMin = 100.0))
+	float CellSize;
+
+	// How far away a player can be from a cell before its items stop replicating to them
+	UPROPERTY(EditDefaultsOnly, Category = "World Items", meta = (ClampMin = 100.0))
+	float CellNetCullDistance;
+
+	// How close a dropped item has to be to an identical recent drop to be merged into it
+	UPROPERTY(EditDefaultsOnly, Category = "World Items", meta = (ClampMin = 0.0))
+	float DropMergeRadius;
+
+	// How long after being dropped an item can still have other drops merged into it
+	UPROPERTY(EditDefaultsOnly, Category = "World Items", meta = (ClampMin = 0.0))
+	float DropMergeTime;
+
+	// How long a promoted pickup can sit without anybody interacting with it before it's turned back into an instanced item
+	UPROPERTY(EditDefaultsOnly, Category = "World Items", meta = (ClampMin = 1.0))
+	float DemoteDelay;
+
+	// Whether level placed items wait for a player to come near before they are replicated
+	UPROPERTY(EditDefaultsOnly, Category = "Materializing")
+	bool bLazyLevelItems;
+
+	// How close a player has to get to a level placed item for it to be put into a cell
+	UPROPERTY(EditDefaultsOnly, Category = "Materializing", meta = (ClampMin = 0.0))
+	float MaterializeRadius;
+
+	// The most level placed items to put into cells each frame
+	UPROPERTY(EditDefaultsOnly, Category = "Materializing", meta = (ClampMin = 1))
+	int32 MaterializeItemsPerFrame;
+
+	// How long a cell has to go without a player near it before its level placed items go back to being records
+	UPROPERTY(EditDefaultsOnly, Category = "Materializing", meta = (ClampMin = 0.0))
+	float DematerializeDelay;
+
+	// How long a dropped item lasts before it is despawned. 0 means dropped items only go when over MaxDroppedItems
+	UPROPERTY(EditDefaultsOnly, Category = "Despawning", meta = (ClampMin = 0.0))
+	float DespawnTime;
+
+	// Old drops with a player this close to them are left alone until the player leaves
+	UPROPERTY(EditDefaultsOnly, Category = "Despawning", meta = (ClampMin = 0.0))
+	float DespawnPlayerRadius;
+
+	// The most dropped items allowed in the world. Past this the oldest of the least rare items are evicted, even with players nearby
+	UPROPERTY(EditDefaultsOnly, Category = "Despawning", meta = (ClampMin = 1))
+	int32 MaxDroppedItems;
+
+	// How long the despawn pass can run for each frame, in microseconds
+	UPROPERTY(EditDefaultsOnly, Category = "Despawning", meta = (ClampMin = 1.0))
+	float DespawnBudgetMicroseconds;
+
+protected:
+
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	class AWorldItemCell* GetOrCreateCell(const FVector& Location);
+
+	FIntVector GetCellCoord(const FVector& Location) const;
+
+	void GatherPlayerLocations();
+
+	// Queue records near players to be materialized, and dematerialize cells that have been empty for long enough
+	void UpdateRelevancy();
+
+	void MaterializeQueuedRecords();
+
+	// Turn the level placed items in a cell back into records. Destroys the cell if it ends up empty
+	void DematerializeCell(const FIntVector& CellCoord, class AWorldItemCell* Cell);
+
+	void DemoteIdlePickups();
+
+	// Merge as much of a drop as possible into recent drops nearby. Returns how much couldn't be merged
+	int32 MergeIntoRecentDrops(TSubclassOf<class UItem> ItemClass, const int32 Quantity, const FVector& Location, TSubclassOf<class APickup> ItemPickupClass);
+
+	FIntVector GetMergeCoord(const FVector& Location) const;
+
+	void PruneRecentDrops();
+
+	// Start another pass over every dropped item
+	void BeginDespawnPass();
+
+	// Despawn an item if it's old enough, or remember it in case there are too many items. Returns true if it was despawned
+	bool CheckDroppedItem(const FWorldItemHandle& Handle, TSubclassOf<class UItem> ItemClass, const float ItemDropTime, const FVector& Location);
+
+	// Keep a candidate the pass found if it's one of the least valuable, so it can be evicted
+	void AddEvictionCandidate(const FDespawnCandidate& Candidate);
+
+	// Resync the dropped item count, and replace the evictions with the ones the pass picked
+	void FinishDespawnPass();
+
+	bool DespawnItem(const FWorldItemHandle& Handle);
+
+	// Whether the item a handle points to is still in the world
+	bool IsHandleValid(const FWorldItemHandle& Handle) const;
+
+	// Evict the least valuable drops until there are no more than TargetCount. Returns false if it ran out of time
+	bool EvictDroppedItems(const int32 TargetCount, const double EndTime);
+
+	// How many dropped items we evict down to, a bit under the cap so we aren't evicting again after every drop
+	int32 GetEvictionTargetCount() const;
+
+	void CheckDroppedPickup(class APickup* Pickup);
+
+	bool IsPlayerNear(const FVector& Location) const;
+
+	UPROPERTY()
+	TMap<FIntVector, class AWorldItemCell*> Cells;
+
+	// Pickups that have been promoted from world items, and the time they were last in use
+	UPROPERTY()
+	TMap<class APickup*, float> PromotedPickups;
+
+	// Recent drops, hashed by DropMergeRadius sized cells
+	TMultiMap<FIntVector, FRecentDrop> RecentDrops;
+
+	// Level placed items that haven't been materialized, by cell
+	TMap<FIntVector, TArray<FWorldItemRecord>> Records;
+
+	// Cells with records near a player, waiting to be materialized
+	TArray<FIntVector> MaterializeQueue;
+
+	// When each cell last had a player near it
+	TMap<FIntVector, float> CellRelevantTimes;
+
+	// Pickups spawned for dropped items when bInstanceWorldItems is off. Promoted pickups are checked through PromotedPickups
+	TArray<TWeakObjectPtr<class APickup>> DroppedPickups;
+
+	// Where the current despawn pass is up to
+	TArray<TWeakObjectPtr<class APickup>> DespawnPassPickups;
+	TArray<TWeakObjectPtr<class AWorldItemCell>> DespawnPassCells;
+	int32 DespawnPassPickupIndex;
+	int32 DespawnPassCellIndex;
+	int32 DespawnPassEntryIndex;
+	bool bDespawnPassRunning;
+
+	// Every dropped item the current pass has kept, for picking which to evict
+	TArray<FDespawnCandidate> DespawnCandidates;
+
+	// The least valuable candidates seen so far, with the most valuable of them on top. Built a few candidates at a time
+	// once the pass has been through every cell
+	TArray<FDespawnCandidate> EvictionHeap;
+	int32 DespawnPassCandidateIndex;
+	int32 NumEvictionsToPick;
+	int32 NumValidCandidates;
+
+	// Items to evict whenever we go over the cap, as a heap with the least valuable on top. Replaced at the end of every pass
+	TArray<FDespawnCandidate> PendingEvictions;
+
+	// Dropped items in the world. Kept up to date as items are dropped, taken and despawned, and resynced every pass
+	int32 NumDroppedItems;
+
+	// Player locations for this frame
+	TArray<FVector> PlayerLocations;
+
+	FTimerHandle TimerHandle_DemoteIdlePickups;
+	FTimerHandle TimerHandle_PruneRecentDrops;
+	FTimerHandle TimerHandle_UpdateRelevancy;
+
+};
@@ -2,4 +2,10 @@
 
 
 #include "SurvivalGameGameModeBase.h"
+#include "Player/SurvivalHUD.h"
 
+ASurvivalGameGameModeBase::ASurvivalGameGameModeBase()
+{
+	// The HUD draws the interaction prompt
+	HUDClass = ASurvivalHUD::StaticClass();
+}
@@ -13,5 +13,9 @@ UCLASS()
 class SURVIVALGAME_API ASurvivalGameGameModeBase : public AGameModeBase
 {
 	GENERATED_BODY()
+
+public:
+
+	ASurvivalGameGameModeBase();
 	
 };
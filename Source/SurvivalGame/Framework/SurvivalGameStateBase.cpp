@@ -2,4 +2,16 @@
 
 
 #include "SurvivalGameStateBase.h"
+#include "Components/WorldItemManagerComponent.h"
+#include "Components/PickupPoolComponent.h"
+#include "Components/LootRespawnComponent.h"
+#include "Components/InteractionSchedulerComponent.h"
+
+ASurvivalGameStateBase::ASurvivalGameStateBase()
+{
+	WorldItemManager = CreateDefaultSubobject<UWorldItemManagerComponent>("WorldItemManager");
+	PickupPool = CreateDefaultSubobject<UPickupPoolComponent>("PickupPool");
+	LootRespawn = CreateDefaultSubobject<ULootRespawnComponent>("LootRespawn");
+	InteractionScheduler = CreateDefaultSubobject<UInteractionSchedulerComponent>("InteractionScheduler");
+}
 
@@ -13,5 +13,21 @@ UCLASS()
 class SURVIVALGAME_API ASurvivalGameStateBase : public AGameStateBase
 {
 	GENERATED_BODY()
+
+public:
+
+	ASurvivalGameStateBase();
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	class UWorldItemManagerComponent* WorldItemManager;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	class UPickupPoolComponent* PickupPool;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	class ULootRespawnComponent* LootRespawn;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	class UInteractionSchedulerComponent* InteractionScheduler;
 	
 };
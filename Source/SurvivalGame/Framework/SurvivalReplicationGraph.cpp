@@ -0,0 +1,303 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalReplicationGraph.h"
+#include "SurvivalGame.h"
+#include "World/Pickup.h"
+#include "World/LootBag.h"
+#include "World/WorldItemCell.h"
+#include "Engine/NetConnection.h"
+#include "Engine/LevelScriptActor.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/PlayerController.h"
+#include "UObject/UObjectIterator.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Rep Graph Spatialized Actors"), STAT_RepGraphSpatializedActors, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Rep Graph Owner Only Actors"), STAT_RepGraphOwnerOnlyActors, STATGROUP_SurvivalGame);
+
+USurvivalReplicationGraph::USurvivalReplicationGraph()
+{
+	GridCellSize = 10000.f;
+	SpatialBias = FVector2D(-200000.f, -200000.f);
+	bDisableSpatialRebuilds = true;
+	DestructionInfoMaxDistance = 15000.f;
+}
+
+void USurvivalReplicationGraph::RefreshActorRouting(AActor* Actor)
+{
+	UNetDriver* NetDriver = Actor ? Actor->GetNetDriver() : nullptr;
+
+	if (USurvivalReplicationGraph* Graph = NetDriver ? Cast<USurvivalReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr)
+	{
+		Graph->RemoveNetworkActor(Actor);
+		Graph->AddNetworkActor(Actor);
+	}
+}
+
+void USurvivalReplicationGraph::ResetGameWorldState()
+{
+	Super::ResetGameWorldState();
+
+	OwnerOnlyActors.Reset();
+	PendingOwnerOnlyActors.Reset();
+}
+
+void USurvivalReplicationGraph::InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class)
+{
+	const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+
+	Info.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(FMath::Max(ActorCDO->NetUpdateFrequency, 1.f));
+
+	// Spatialized actors are culled by the grid using this distance, everything else is always relevant
+	if (ClassPolicyMap.GetChecked(Class) >= ESurvivalRepNodePolicy::Spatialize_Static)
+	{
+		Info.CullDistanceSquared = ActorCDO->NetCullDistanceSquared;
+	}
+	else
+	{
+		Info.CullDistanceSquared = 0.f;
+	}
+}
+
+void USurvivalReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Engine classes the graph already deals with
+	ClassPolicyMap.Set(AActor::StaticClass(), ESurvivalRepNodePolicy::Spatialize_Dynamic);
+	ClassPolicyMap.Set(ALevelScriptActor::StaticClass(), ESurvivalRepNodePolicy::NotRouted);
+	ClassPolicyMap.Set(APlayerController::StaticClass(), ESurvivalRepNodePolicy::NotRouted);
+	ClassPolicyMap.Set(APlayerState::StaticClass(), ESurvivalRepNodePolicy::NotRouted);
+	ClassPolicyMap.Set(AGameStateBase::StaticClass(), ESurvivalRepNodePolicy::RelevantAllConnections);
+	ClassPolicyMap.Set(APawn::StaticClass(), ESurvivalRepNodePolicy::Spatialize_Dynamic);
+
+	// Loot stays where it was put, the pickup pool refreshes pickups it moves
+	ClassPolicyMap.Set(APickup::StaticClass(), ESurvivalRepNodePolicy::Spatialize_Static);
+	ClassPolicyMap.Set(ALootBag::StaticClass(), ESurvivalRepNodePolicy::Spatialize_Static);
+	ClassPolicyMap.Set(AWorldItemCell::StaticClass(), ESurvivalRepNodePolicy::Spatialize_Static);
+
+	for (const FSurvivalRepClassPolicy& ClassPolicy : ClassPolicies)
+	{
+		if (UClass* Class = ClassPolicy.ClassName.TryLoadClass<AActor>())
+		{
+			ClassPolicyMap.Set(Class, ClassPolicy.Policy);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Replication graph couldn't load class %s for its class policies"), *ClassPolicy.ClassName.ToString());
+		}
+	}
+
+	// Set up every replicated class now, instead of when the first actor of each class spawns
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+
+		if (!Class->IsChildOf(AActor::StaticClass()) || Class->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists))
+		{
+			continue;
+		}
+
+		const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+
+		if (!ActorCDO->GetIsReplicated() || Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+
+		FClassReplicationInfo ClassInfo;
+		InitClassReplicationInfo(ClassInfo, Class);
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+
+	DestructInfoMaxDistanceSquared = FMath::Square(DestructionInfoMaxDistance);
+}
+
+void USurvivalReplicationGraph::InitGlobalGraphNodes()
+{
+	PreAllocateRepList(3, 12);
+	PreAllocateRepList(6, 12);
+	PreAllocateRepList(128, 64);
+	PreAllocateRepList(512, 16);
+
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = SpatialBias;
+
+	if (bDisableSpatialRebuilds)
+	{
+		GridNode->AddSpatialRebuildBlacklistClass(AActor::StaticClass());
+	}
+
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+
+	// Player states are needed by everyone, but don't need to all replicate every frame
+	UReplicationGraphNode_PlayerStateFrequencyLimiter* PlayerStateNode = CreateNewNode<UReplicationGraphNode_PlayerStateFrequencyLimiter>();
+	AddGlobalGraphNode(PlayerStateNode);
+}
+
+void USurvivalReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// Adds the connections own controller and view target, plus anything owner only routed to it
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* ConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(ConnectionNode, RepGraphConnection);
+
+	ConnectionNodes.Add(RepGraphConnection->NetConnection, ConnectionNode);
+}
+
+void USurvivalReplicationGraph::RemoveClientConnection(UNetConnection* NetConnection)
+{
+	ConnectionNodes.Remove(NetConnection);
+
+	Super::RemoveClientConnection(NetConnection);
+}
+
+int32 USurvivalReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	RoutePendingOwnerOnlyActors();
+
+	return Super::ServerReplicateActors(DeltaSeconds);
+}
+
+bool USurvivalReplicationGraph::AddOwnerOnlyActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	AActor* Actor = ActorInfo.Actor;
+	UNetConnection* OwnerConnection = Actor->GetNetConnection();
+	UReplicationGraphNode_AlwaysRelevant_ForConnection** ConnectionNode = OwnerConnection ? ConnectionNodes.Find(OwnerConnection) : nullptr;
+
+	if (!ConnectionNode)
+	{
+		return false;
+	}
+
+	(*ConnectionNode)->NotifyAddNetworkActor(ActorInfo);
+	OwnerOnlyActors.Add(Actor, OwnerConnection);
+	INC_DWORD_STAT(STAT_RepGraphOwnerOnlyActors);
+
+	return true;
+}
+
+void USurvivalReplicationGraph::RoutePendingOwnerOnlyActors()
+{
+	for (int32 i = PendingOwnerOnlyActors.Num() - 1; i >= 0; --i)
+	{
+		AActor* Actor = PendingOwnerOnlyActors[i].Get();
+
+		if (!Actor || Actor->IsPendingKillPending() || AddOwnerOnlyActor(FNewReplicatedActorInfo(Actor)))
+		{
+			PendingOwnerOnlyActors.RemoveAtSwap(i, 1, false);
+		}
+	}
+}
+
+ESurvivalRepNodePolicy USurvivalReplicationGraph::GetPolicyForActor(const AActor* Actor)
+{
+	// Flags on the actor win over its class, so an always relevant actor is never culled by the grid
+	if (Actor->bOnlyRelevantToOwner && !Actor->IsA<APlayerController>())
+	{
+		return ESurvivalRepNodePolicy::OwnerOnly;
+	}
+
+	if (Actor->bAlwaysRelevant && !Actor->IsA<APlayerState>())
+	{
+		return ESurvivalRepNodePolicy::RelevantAllConnections;
+	}
+
+	if (const ESurvivalRepNodePolicy* Policy = ClassPolicyMap.Get(Actor->GetClass()))
+	{
+		return *Policy;
+	}
+
+	return ESurvivalRepNodePolicy::Spatialize_Dynamic;
+}
+
+void USurvivalReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	AActor* Actor = ActorInfo.Actor;
+	const ESurvivalRepNodePolicy Policy = GetPolicyForActor(Actor);
+
+	// The world item manager changes the cull distance of each cell, so use the actors own value rather than the class default
+	if (Policy >= ESurvivalRepNodePolicy::Spatialize_Static)
+	{
+		GlobalInfo.Settings.CullDistanceSquared = Actor->NetCullDistanceSquared;
+		INC_DWORD_STAT(STAT_RepGraphSpatializedActors);
+	}
+
+	switch (Policy)
+	{
+	case ESurvivalRepNodePolicy::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case ESurvivalRepNodePolicy::OwnerOnly:
+		// Owner only actors without an owning connection aren't relevant to anyone yet. They are routed once they have one
+		if (!AddOwnerOnlyActor(ActorInfo))
+		{
+			PendingOwnerOnlyActors.AddUnique(Actor);
+		}
+		break;
+	case ESurvivalRepNodePolicy::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case ESurvivalRepNodePolicy::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case ESurvivalRepNodePolicy::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+void USurvivalReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	AActor* Actor = ActorInfo.Actor;
+	const ESurvivalRepNodePolicy Policy = GetPolicyForActor(Actor);
+
+	if (Policy >= ESurvivalRepNodePolicy::Spatialize_Static)
+	{
+		DEC_DWORD_STAT(STAT_RepGraphSpatializedActors);
+	}
+
+	switch (Policy)
+	{
+	case ESurvivalRepNodePolicy::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case ESurvivalRepNodePolicy::OwnerOnly:
+	{
+		// The owner could have changed since the actor was routed, so remove it from the connection it was added to
+		TWeakObjectPtr<UNetConnection> OwnerConnection;
+		PendingOwnerOnlyActors.RemoveSingleSwap(Actor, false);
+
+		if (OwnerOnlyActors.RemoveAndCopyValue(Actor, OwnerConnection))
+		{
+			if (UReplicationGraphNode_AlwaysRelevant_ForConnection** ConnectionNode = ConnectionNodes.Find(OwnerConnection.Get()))
+			{
+				(*ConnectionNode)->NotifyRemoveNetworkActor(ActorInfo);
+			}
+
+			DEC_DWORD_STAT(STAT_RepGraphOwnerOnlyActors);
+		}
+		break;
+	}
+	case ESurvivalRepNodePolicy::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case ESurvivalRepNodePolicy::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case ESurvivalRepNodePolicy::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	default:
+		break;
+	}
+}
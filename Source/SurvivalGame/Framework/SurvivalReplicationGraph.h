@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "SurvivalReplicationGraph.generated.h"
+
+// How the replication graph decides which connections an actor replicates to
+UENUM()
+enum class ESurvivalRepNodePolicy : uint8
+{
+	// Not put in any node. Used for actors the graph already handles, like player controllers
+	NotRouted,
+	// Replicates to every connection
+	RelevantAllConnections,
+	// Only replicates to the connection of the player that owns it
+	OwnerOnly,
+	// Put on the spatial grid once. For actors that don't move, such as pickups and world item cells
+	Spatialize_Static,
+	// Put on the spatial grid and moved around it every frame. For characters and anything else that moves
+	Spatialize_Dynamic,
+	// Treated as static while dormant and dynamic while awake
+	Spatialize_Dormancy
+};
+
+// Lets the policy for a class be set from ini
+USTRUCT()
+struct FSurvivalRepClassPolicy
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FSoftClassPath ClassName;
+
+	UPROPERTY()
+	ESurvivalRepNodePolicy Policy = ESurvivalRepNodePolicy::Spatialize_Dynamic;
+};
+
+/**
+ * Replication graph for SurvivalGame. Instead of checking every actor against every connection, pickups and world item cells
+ * are put on a spatial grid and only gathered from the cells around each player. The game state is always relevant, and
+ * owner only actors go straight to their owners connection.
+ *
+ * Enable it by adding this to DefaultEngine.ini:
+ *
+ * [/Script/OnlineSubsystemUtils.IpNetDriver]
+ * ReplicationDriverClassName="/Script/SurvivalGame.SurvivalReplicationGraph"
+ *
+ * The settings below live in the [/Script/SurvivalGame.SurvivalReplicationGraph] section.
+ */
+UCLASS(Transient, Config = Engine)
+class SURVIVALGAME_API USurvivalReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+
+	USurvivalReplicationGraph();
+
+	// [server] Re-route an actor, eg after a static actor was teleported or its net cull distance was changed
+	static void RefreshActorRouting(AActor* Actor);
+
+	// Width of each cell in the spatial grid
+	UPROPERTY(Config)
+	float GridCellSize;
+
+	// Where the spatial grid starts. Actors below this get the grid rebuilt, so set it to the bottom corner of the map
+	UPROPERTY(Config)
+	FVector2D SpatialBias;
+
+	// If false the grid is rebuilt when an actor leaves it, which causes a hitch
+	UPROPERTY(Config)
+	bool bDisableSpatialRebuilds;
+
+	// How far away destruction info for static actors, like taken pickups, is sent
+	UPROPERTY(Config)
+	float DestructionInfoMaxDistance;
+
+	// Overrides for the policy used for each class. Subclasses use the policy of their closest parent
+	UPROPERTY(Config)
+	TArray<FSurvivalRepClassPolicy> ClassPolicies;
+
+	virtual void ResetGameWorldState() override;
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual void RemoveClientConnection(UNetConnection* NetConnection) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+protected:
+
+	ESurvivalRepNodePolicy GetPolicyForActor(const AActor* Actor);
+
+	// Sets up replication frequency and cull distance from the class defaults
+	void InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class);
+
+	// Add an owner only actor to its owners connection node. Returns false if the owner has no connection node yet
+	bool AddOwnerOnlyActor(const FNewReplicatedActorInfo& ActorInfo);
+
+	// Try again to route owner only actors that had no owning connection when they were added
+	void RoutePendingOwnerOnlyActors();
+
+	UPROPERTY()
+	class UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	class UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	// The always relevant node of each connection, for owner only actors
+	UPROPERTY()
+	TMap<UNetConnection*, class UReplicationGraphNode_AlwaysRelevant_ForConnection*> ConnectionNodes;
+
+	// Owner only actors that have been routed, and the connection they were routed to
+	TMap<TWeakObjectPtr<AActor>, TWeakObjectPtr<UNetConnection>> OwnerOnlyActors;
+
+	// Owner only actors waiting on an owner with a connection, eg a pawn that hasn't been possessed yet or whose player is still joining
+	TArray<TWeakObjectPtr<AActor>> PendingOwnerOnlyActors;
+
+	TClassMap<ESurvivalRepNodePolicy> ClassPolicyMap;
+
+};
@@ -2,7 +2,6 @@
 
 
 #include "EquippableItem.h"
-#include "Net/UnrealNetwork.h"
 #include "Player/SurvivalCharacter.h"
 #include "Components/InventoryComponent.h"
 
@@ -15,13 +14,6 @@ UEquippableItem::UEquippableItem()
 	UseActionText = LOCTEXT("ItemUseActionText", "Equip");
 }
 
-void UEquippableItem::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
-{
-	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-
-	DOREPLIFETIME(UEquippableItem, bEquipped);
-}
-
 void UEquippableItem::Use(ASurvivalCharacter* Character)
 {
 	if (Character && Character->HasAuthority())
@@ -57,16 +49,37 @@ bool UEquippableItem::UnEquip(ASurvivalCharacter* Character)
 
 bool UEquippableItem::ShouldShowInInventory() const
 {
-	return !bEquipped;
+	return Super::ShouldShowInInventory() && !bEquipped;
 }
 
 void UEquippableItem::SetEquipped(bool bNewEquipped)
 {
 	bEquipped = bNewEquipped;
+	NetState.bEquipped = bEquipped;
 	EquipStatusChanged();
 	MarkDirtyForReplication();
 }
 
+void UEquippableItem::SetEquippedLocal(bool bNewEquipped)
+{
+	if (bEquipped != bNewEquipped)
+	{
+		bEquipped = bNewEquipped;
+		EquipStatusChanged();
+	}
+}
+
+void UEquippableItem::NetStateReceived()
+{
+	Super::NetStateReceived();
+
+	if (bEquipped != NetState.bEquipped)
+	{
+		bEquipped = NetState.bEquipped;
+		EquipStatusChanged();
+	}
+}
+
 void UEquippableItem::EquipStatusChanged()
 {
 	if (ASurvivalCharacter* Character = Cast<ASurvivalCharacter>(GetOuter()))
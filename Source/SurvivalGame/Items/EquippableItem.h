@@ -36,8 +36,6 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Equippables")
 	EEquippableSlot Slot;
 
-	virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
-
 	virtual void Use(class ASurvivalCharacter* Character) override;
 
 	UFUNCTION(BlueprintCallable, Category = "Equippables")
@@ -49,15 +47,21 @@ public:
 	virtual bool ShouldShowInInventory() const override;
 
 	UFUNCTION(BlueprintPure, Category = "Equippables")
-	bool IsEquipped() { return bEquipped; };
+	bool IsEquipped() const { return bEquipped; };
 
 	void SetEquipped(bool bNewEquipped);
 
+	// [local] Equip or unequip without touching NetState or marking anything dirty. Used for client side prediction,
+	// the real state arrives through NetState
+	void SetEquippedLocal(bool bNewEquipped);
+
 protected:
 
-	UPROPERTY(ReplicatedUsing = EquipStatusChanged)
+	// Replicated through NetState
+	UPROPERTY()
 	bool bEquipped;
 
-	UFUNCTION()
+	virtual void NetStateReceived() override;
+
 	void EquipStatusChanged();
 };
@@ -2,16 +2,101 @@
 
 
 #include "Item.h"
+#include "SurvivalGame.h"
 #include "Components/InventoryComponent.h"
+#include "Items/EquippableItem.h"
 #include "Net/UnrealNetwork.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+#include "UObject/CoreNet.h"
 
 #define LOCTEXT_NAMESPACE "Item"
 
+bool FItemNetState::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 Flags = bEquipped ? 1 : 0;
+	Ar.SerializeBits(&Flags, 1);
+
+	// Send the width of the quantity first so the receiver never needs to know the items max stack size
+	uint32 QuantityBits = FMath::Clamp<uint32>(FMath::CeilLogTwo(FMath::Max(MaxQuantity, 1) + 1), 1, 31);
+	Ar.SerializeInt(QuantityBits, 32);
+
+	uint32 PackedQuantity = FMath::Max(Quantity, 0);
+	Ar.SerializeInt(PackedQuantity, 1u << QuantityBits);
+
+	if (Ar.IsLoading())
+	{
+		bEquipped = (Flags & 1) != 0;
+		Quantity = PackedQuantity;
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+// Logs roughly how many bits every live items state costs with NetState, compared to sending Quantity and bEquipped as their own properties.
+// Each property is written behind a packed handle and the list ends with a zero handle, the same as the rep layout does. Bunch and
+// subobject headers are the same either way, so they are left out
+static FAutoConsoleCommand CompareItemStateBitsCommand(
+	TEXT("Survival.CompareItemStateBits"),
+	TEXT("Logs an estimate of the replicated size of every live item with packed item state versus the old per-property layout"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		int64 PackedBits = 0;
+		int64 UnpackedBits = 0;
+		int32 NumItems = 0;
+
+		for (TObjectIterator<UItem> It; It; ++It)
+		{
+			UItem* Item = *It;
+
+			if (Item->HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+			{
+				continue;
+			}
+
+			FItemNetState State;
+			State.Quantity = Item->GetQuantity();
+			State.MaxQuantity = Item->bStackable ? Item->MaxStackSize : 1;
+
+			uint32 Handle = 1;
+			uint32 EndHandle = 0;
+
+			FNetBitWriter PackedWriter(1024);
+			bool bSuccess = true;
+			PackedWriter.SerializeIntPacked(Handle);
+			State.NetSerialize(PackedWriter, nullptr, bSuccess);
+			PackedWriter.SerializeIntPacked(EndHandle);
+
+			FNetBitWriter UnpackedWriter(1024);
+			int32 Quantity = Item->GetQuantity();
+			UnpackedWriter.SerializeIntPacked(Handle);
+			UnpackedWriter << Quantity;
+
+			if (UEquippableItem* EquippableItem = Cast<UEquippableItem>(Item))
+			{
+				uint8 bEquipped = EquippableItem->IsEquipped() ? 1 : 0;
+				Handle = 2;
+				UnpackedWriter.SerializeIntPacked(Handle);
+				UnpackedWriter.SerializeBits(&bEquipped, 1);
+			}
+
+			UnpackedWriter.SerializeIntPacked(EndHandle);
+
+			PackedBits += PackedWriter.GetNumBits();
+			UnpackedBits += UnpackedWriter.GetNumBits();
+			++NumItems;
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("Item state for %d items (estimate): %lld bits packed, %lld bits unpacked"), NumItems, PackedBits, UnpackedBits);
+	})
+);
+
 void UItem::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UItem, Quantity);
+	SURVIVAL_DOREPLIFETIME_PUSH(UItem, NetState);
 }
 
 bool UItem::IsSupportedForNetworking() const
@@ -19,6 +104,29 @@ bool UItem::IsSupportedForNetworking() const
 	return true;
 }
 
+void UItem::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	// Blueprint defaults have been applied by now, so the stack size is final
+	NetState.Quantity = Quantity;
+	NetState.MaxQuantity = bStackable ? MaxStackSize : 1;
+}
+
+void UItem::OnRep_NetState()
+{
+	NetStateReceived();
+}
+
+void UItem::NetStateReceived()
+{
+	if (Quantity != NetState.Quantity)
+	{
+		Quantity = NetState.Quantity;
+		OnRep_Quantity();
+	}
+}
+
 #if WITH_EDITOR
 // Clamps the quantity value to the max stack size in the UE editor
 void UItem::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
@@ -43,10 +151,19 @@ UItem::UItem()
 	Quantity = 1;
 	MaxStackSize = 2;
 	RepKey = 0;
+	NetState.Quantity = Quantity;
+	NetState.MaxQuantity = MaxStackSize;
+	InventoryVersion = 0;
+	bSnapshotStandIn = false;
 }
 
 void UItem::OnRep_Quantity()
 {
+	if (OwningInventory)
+	{
+		OwningInventory->ReapplyPredictions(this);
+	}
+
 	OnItemModified.Broadcast();
 }
 
@@ -55,13 +172,15 @@ void UItem::SetQuantity(const int32 NewQuantity)
 	if (NewQuantity != Quantity)
 	{
 		Quantity = FMath::Clamp(NewQuantity, 0, bStackable ? MaxStackSize : 1);
+		NetState.Quantity = Quantity;
 		MarkDirtyForReplication();
 	}
 }
 
 bool UItem::ShouldShowInInventory() const
 {
-	return true;
+	// A predicted drop can leave an item with nothing in it until the server removes it
+	return Quantity > 0;
 }
 
 void UItem::Use(ASurvivalCharacter* Character)
@@ -76,11 +195,13 @@ void UItem::MarkDirtyForReplication()
 {
 	// Mark this object for replication
 	++RepKey;
+	SURVIVAL_MARK_PROPERTY_DIRTY(UItem, NetState, this);
 
 	// Mark the array for replication
 	if (OwningInventory)
 	{
 		++OwningInventory->ReplicatedItemsKey;
+		InventoryVersion = OwningInventory->ReplicatedItemsKey;
 	}
 }
 
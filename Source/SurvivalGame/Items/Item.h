@@ -18,6 +18,42 @@ enum class EItemRarity : uint8
 	IR_Legendary UMETA(DisplayName = "Legendary"),
 };
 
+// All of an items replicated state, packed into as few bits as possible by NetSerialize
+USTRUCT()
+struct FItemNetState
+{
+	GENERATED_BODY()
+
+	FItemNetState()
+	{
+		Quantity = 1;
+		bEquipped = false;
+		MaxQuantity = 1;
+	}
+
+	UPROPERTY()
+	int32 Quantity;
+
+	// Only used by equippable items
+	UPROPERTY()
+	uint8 bEquipped : 1;
+
+	// The largest quantity the item can have, which decides how many bits the quantity is sent with.
+	// Not a UPROPERTY since the bit width is written into the stream and never needs comparing
+	int32 MaxQuantity;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FItemNetState> : public TStructOpsTypeTraitsBase2<FItemNetState>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
 /**
  * 
  */
@@ -30,6 +66,17 @@ protected:
 
 	virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual bool IsSupportedForNetworking() const override;
+	virtual void PostInitProperties() override;
+
+	// The replicated copy of the items state. Keep this in sync whenever Quantity or any other replicated state changes
+	UPROPERTY(ReplicatedUsing = OnRep_NetState)
+	FItemNetState NetState;
+
+	UFUNCTION()
+	void OnRep_NetState();
+
+	// Called on clients when a new NetState arrives, copy any state out of it here
+	virtual void NetStateReceived();
 
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent) override;
@@ -79,8 +126,8 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Item")
 	TSubclassOf<class UItemTooltip> ItemTooltip;
 
-	// The amount of the item (handled by the server)
-	UPROPERTY(ReplicatedUsing = OnRep_Quantity, EditAnywhere, Category = "Item", meta = (UIMin = 1, EditCondition = bStackable))
+	// The amount of the item (handled by the server, replicated through NetState)
+	UPROPERTY(EditAnywhere, Category = "Item", meta = (UIMin = 1, EditCondition = bStackable))
 	int32 Quantity;
 
 	// Pointer to the inventory that owns this item
@@ -91,10 +138,15 @@ public:
 	UPROPERTY()
 	int32 RepKey;
 
+	// [server] The inventory version this item last changed at, so items the owner already has from a snapshot aren't sent again
+	int32 InventoryVersion;
+
+	// [local] Set on the read only stand ins built from an inventory snapshot. The server doesn't know about these, so they can't be used or dropped
+	bool bSnapshotStandIn;
+
 	UPROPERTY(BlueprintAssignable)
 	FOnItemModified OnItemModified;
 
-	UFUNCTION()
 	void OnRep_Quantity();
 
 	UFUNCTION(BlueprintCallable, Category = "Item")
@@ -109,6 +161,10 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Item")
 	virtual bool ShouldShowInInventory() const;
 
+	// Stand ins are only for display until the real item replicates
+	UFUNCTION(BlueprintPure, Category = "Item")
+	FORCEINLINE bool IsSnapshotStandIn() const { return bSnapshotStandIn; }
+
 	virtual void Use(class ASurvivalCharacter* Character);
 	virtual void AddedToInventory(class UInventoryComponent* Inventory);
 
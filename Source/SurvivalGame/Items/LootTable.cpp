@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LootTable.h"
+
+const FLootTableEntry* ULootTable::RollEntry() const
+{
+	float TotalWeight = 0.f;
+
+	for (const FLootTableEntry& Entry : Entries)
+	{
+		if (Entry.ItemClass)
+		{
+			TotalWeight += Entry.Weight;
+		}
+	}
+
+	float Roll = FMath::FRand() * TotalWeight;
+
+	for (const FLootTableEntry& Entry : Entries)
+	{
+		if (Entry.ItemClass && Entry.Weight > 0.f)
+		{
+			if (Roll < Entry.Weight)
+			{
+				return &Entry;
+			}
+
+			Roll -= Entry.Weight;
+		}
+	}
+
+	return nullptr;
+}
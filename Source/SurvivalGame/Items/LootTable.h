@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "LootTable.generated.h"
+
+// One item a loot table can roll
+USTRUCT(BlueprintType)
+struct FLootTableEntry
+{
+	GENERATED_BODY()
+
+	FLootTableEntry()
+	{
+		ItemClass = nullptr;
+		MinQuantity = 1;
+		MaxQuantity = 1;
+		Weight = 1.f;
+	}
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot")
+	TSubclassOf<class UItem> ItemClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = 1))
+	int32 MinQuantity;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = 1))
+	int32 MaxQuantity;
+
+	// How likely this entry is to be rolled, compared to the other entries
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = 0.0))
+	float Weight;
+};
+
+/**
+ * A list of items a loot spawn point can spawn, picked at random by weight
+ */
+UCLASS(BlueprintType)
+class SURVIVALGAME_API ULootTable : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot")
+	TArray<FLootTableEntry> Entries;
+
+	// Pick an entry at random, or null if the table is empty
+	const FLootTableEntry* RollEntry() const;
+
+};
@@ -5,24 +5,48 @@
 #include "Camera/CameraComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
 #include "Components/CapsuleComponent.h"
+#include "Components/SphereComponent.h"
 #include "Components/InventoryComponent.h"
 #include "Components/InteractionComponent.h"
 #include "Items/EquippableItem.h"
 #include "Items/GearItem.h"
 #include "Materials/MaterialInstance.h"
 #include "World/Pickup.h"
+#include "World/WorldItemCell.h"
+#include "World/LootBag.h"
+#include "Components/WorldItemManagerComponent.h"
+#include "Components/InteractionSchedulerComponent.h"
+#include "SurvivalGame.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ticking Characters"), STAT_TickingCharacters, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interacts Accepted Without Trace"), STAT_InteractsAccepted, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interacts Rejected"), STAT_InteractsRejected, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interacts Needing Trace"), STAT_InteractsNeedingTrace, STATGROUP_SurvivalGame);
 
 // Sets default values
 ASurvivalCharacter::ASurvivalCharacter()
 {
- 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+ 	// Tick only drives the local players interaction checks, so it starts off and is turned on in UpdateInteractionRole.
+	// The server and simulated proxies never tick the character at all
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	CameraComponent = CreateDefaultSubobject<UCameraComponent>("CameraComponent");
 	CameraComponent->SetupAttachment(GetMesh(), FName("CameraSocket")); // Attaches the component we created to the main mesh component
 	CameraComponent->bUsePawnControlRotation = true; // Follow the characters movement
 
+	// Only overlaps with world dynamic objects, which is what pickups and world item meshes are. Enabled in UpdateInteractionRole
+	InteractionSphere = CreateDefaultSubobject<USphereComponent>("InteractionSphere");
+	InteractionSphere->SetupAttachment(GetRootComponent());
+	InteractionSphere->SetCollisionObjectType(ECC_WorldDynamic);
+	InteractionSphere->SetCollisionResponseToAllChannels(ECR_Ignore);
+	InteractionSphere->SetCollisionResponseToChannel(ECC_WorldDynamic, ECR_Overlap);
+	InteractionSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	InteractionSphere->SetGenerateOverlapEvents(true);
+
 	HelmetMesh = PlayerMeshes.Add(EEquippableSlot::EIS_Helmet, CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("HelmetMesh")));
 	ChestMesh = PlayerMeshes.Add(EEquippableSlot::EIS_Chest, CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("ChestMesh")));
 	LegsMesh = PlayerMeshes.Add(EEquippableSlot::EIS_Legs, CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("LegsMesh")));
@@ -47,6 +71,25 @@ ASurvivalCharacter::ASurvivalCharacter()
 
 	InteractionCheckFrequency = 0.f;
 	InteractionCheckDistance = 1000.f;
+	InteractionViewConeAngle = 15.f;
+	WorldItemFocusDistance = 300.f;
+	LootBagClass = ALootBag::StaticClass();
+	LastPromotionRequestItemId = INDEX_NONE;
+	LastPromotionRequestTime = 0.f;
+	PromotionRetryTime = 1.f;
+	bServerInteractPending = false;
+	ServerInteractRequestSerial = 0;
+	bServerInteractReleasedWhilePending = false;
+	ServerInteractDistanceTolerance = 50.f;
+	ServerInteractViewAngle = 60.f;
+	ServerSightCacheTime = 2.f;
+	ServerSightCacheDistance = 100.f;
+	ServerSightViewLocation = FVector::ZeroVector;
+	ServerSightTime = 0.f;
+	MaxInteractLatencyCredit = 0.3f;
+	ServerInteractClientStartTime = 0.f;
+
+	InteractionTraceDelegate.BindUObject(this, &ASurvivalCharacter::OnInteractionTraceDone);
 
 	GetMesh()->SetOwnerNoSee(true);
 
@@ -63,6 +106,114 @@ void ASurvivalCharacter::BeginPlay()
 		NakedMeshes.Add(PlayerMesh.Key, PlayerMesh.Value->SkeletalMesh);
 	}
 
+	InteractionSphere->SetSphereRadius(InteractionCheckDistance);
+	InteractionSphere->OnComponentBeginOverlap.AddDynamic(this, &ASurvivalCharacter::OnInteractionSphereBeginOverlap);
+	InteractionSphere->OnComponentEndOverlap.AddDynamic(this, &ASurvivalCharacter::OnInteractionSphereEndOverlap);
+	SetActorTickInterval(InteractionCheckFrequency);
+	UpdateInteractionRole();
+}
+
+void ASurvivalCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (IsActorTickEnabled())
+	{
+		DEC_DWORD_STAT(STAT_TickingCharacters);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ASurvivalCharacter::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+
+	// Give a joining or reconnecting player their whole inventory in one go, instead of waiting on every item to replicate
+	if (PlayerInventory && PlayerInventory->GetItems().Num() > 0 && NewController && !NewController->IsLocalController())
+	{
+		PlayerInventory->SendSnapshot();
+	}
+
+	UpdateInteractionRole();
+}
+
+void ASurvivalCharacter::PawnClientRestart()
+{
+	Super::PawnClientRestart();
+
+	UpdateInteractionRole();
+}
+
+void ASurvivalCharacter::UnPossessed()
+{
+	Super::UnPossessed();
+
+	UpdateInteractionRole();
+}
+
+void ASurvivalCharacter::UpdateInteractionRole()
+{
+	// Only the local player looks for interactables, the server checks interacts on demand
+	const bool bNeedsCandidates = IsLocallyControlled();
+	InteractionSphere->SetCollisionEnabled(bNeedsCandidates ? ECollisionEnabled::QueryOnly : ECollisionEnabled::NoCollision);
+
+	// Only the local player polls for interactables
+	const bool bShouldTick = IsLocallyControlled();
+
+	if (bShouldTick != IsActorTickEnabled())
+	{
+		SetActorTickEnabled(bShouldTick);
+
+		if (bShouldTick)
+		{
+			INC_DWORD_STAT(STAT_TickingCharacters);
+		}
+		else
+		{
+			DEC_DWORD_STAT(STAT_TickingCharacters);
+		}
+	}
+
+	if (!bNeedsCandidates)
+	{
+		InteractionCandidates.Empty();
+		NearbyWorldItemCells.Empty();
+	}
+}
+
+void ASurvivalCharacter::OnInteractionSphereBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	if (AWorldItemCell* Cell = Cast<AWorldItemCell>(OtherActor))
+	{
+		NearbyWorldItemCells.AddUnique(Cell);
+	}
+	else if (OtherActor && OtherActor != this)
+	{
+		if (UInteractionComponent* InteractionComponent = UInteractionComponent::FindOnActor(OtherActor))
+		{
+			InteractionCandidates.AddUnique(InteractionComponent);
+		}
+	}
+}
+
+void ASurvivalCharacter::OnInteractionSphereEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+{
+	// Actors can overlap with more than one component, so only forget them once none of them are overlapping
+	if (!OtherActor || InteractionSphere->IsOverlappingActor(OtherActor))
+	{
+		return;
+	}
+
+	if (AWorldItemCell* Cell = Cast<AWorldItemCell>(OtherActor))
+	{
+		NearbyWorldItemCells.RemoveSingleSwap(Cell);
+	}
+	else
+	{
+		InteractionCandidates.RemoveAllSwap([OtherActor](const UInteractionComponent* InteractionComponent)
+		{
+			return !InteractionComponent || InteractionComponent->GetOwner() == OtherActor;
+		});
+	}
 }
 
 bool ASurvivalCharacter::IsInteracting() const
@@ -77,14 +228,22 @@ float ASurvivalCharacter::GetRemainingInteractTime() const
 
 void ASurvivalCharacter::UseItem(UItem* Item)
 {
+	// Snapshot stand ins are display only, the server has no idea they exist
+	if (Item && Item->IsSnapshotStandIn())
+	{
+		return;
+	}
+
 	if (Role < ROLE_Authority && Item)
 	{
-		ServerUseItem(Item);
+		// Apply the use locally straight away so the UI doesn't wait on the server. The server will confirm or reject it
+		const int32 PredictionKey = PlayerInventory ? PlayerInventory->PredictUseItem(Item) : INDEX_NONE;
+		ServerUseItem(Item, PredictionKey);
 	}
 
 	if (HasAuthority())
 	{
-		if (PlayerInventory && !PlayerInventory->FindItem(Item))
+		if (PlayerInventory && !PlayerInventory->ContainsItem(Item))
 		{
 			return;
 		}
@@ -98,57 +257,133 @@ void ASurvivalCharacter::UseItem(UItem* Item)
 
 void ASurvivalCharacter::DropItem(UItem* Item, int32 Quantity)
 {
-	if (PlayerInventory && Item && PlayerInventory->FindItem(Item))
+	if (PlayerInventory && Item && !Item->IsSnapshotStandIn() && PlayerInventory->ContainsItem(Item))
 	{
 		if (Role < ROLE_Authority)
 		{
-			ServerDropItem(Item, Quantity);
+			const int32 PredictionKey = PlayerInventory->PredictQuantityChange(Item, -Quantity);
+			ServerDropItem(Item, Quantity, PredictionKey);
 			return;
 		}
 
 		if (HasAuthority())
 		{
-			const int32 ItemQuantity = Item->GetQuantity();
+			const TSubclassOf<UItem> ItemClass = Item->GetClass();
 			const int32 DroppedQuantity = PlayerInventory->ConsumeItem(Item, Quantity);
 
-			FActorSpawnParameters SpawnParams;
-			SpawnParams.Owner = this;
-			SpawnParams.bNoFail = true;
-			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
-
 			FVector SpawnLocation = GetActorLocation();
 			SpawnLocation.Z -= GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
 
 			FTransform SpawnTransform(GetActorRotation(), SpawnLocation);
 
+			// Let the world item manager store the item without an actor if there is one
+			if (UWorldItemManagerComponent* WorldItemManager = UWorldItemManagerComponent::Get(this))
+			{
+				WorldItemManager->DropWorldItem(ItemClass, DroppedQuantity, SpawnTransform, PickupClass);
+				return;
+			}
+
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.Owner = this;
+			SpawnParams.bNoFail = true;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
 			ensure(PickupClass);
 
 			APickup* Pickup = GetWorld()->SpawnActor<APickup>(PickupClass, SpawnTransform, SpawnParams);
-			Pickup->InitializePickup(Item->GetClass(), DroppedQuantity);
+			Pickup->InitializePickup(ItemClass, DroppedQuantity);
 		}
 	}
 }
 
-void ASurvivalCharacter::ServerUseItem_Implementation(UItem* Item)
+void ASurvivalCharacter::ServerUseItem_Implementation(UItem* Item, const int32 PredictionKey)
 {
+	const bool bCanUse = Item && PlayerInventory && PlayerInventory->ContainsItem(Item);
+
 	UseItem(Item);
+
+	if (PredictionKey != INDEX_NONE && PlayerInventory)
+	{
+		PlayerInventory->ClientAcknowledgePrediction(PredictionKey, bCanUse);
+	}
 }
 
-bool ASurvivalCharacter::ServerUseItem_Validate(UItem* Item)
+bool ASurvivalCharacter::ServerUseItem_Validate(UItem* Item, const int32 PredictionKey)
 {
 	return true;
 }
 
-void ASurvivalCharacter::ServerDropItem_Implementation(UItem* Item, const int32 Quantity)
+void ASurvivalCharacter::ServerDropItem_Implementation(UItem* Item, const int32 Quantity, const int32 PredictionKey)
 {
+	const bool bCanDrop = Item && PlayerInventory && PlayerInventory->ContainsItem(Item) && Quantity > 0;
+
 	DropItem(Item, Quantity);
+
+	if (PredictionKey != INDEX_NONE && PlayerInventory)
+	{
+		PlayerInventory->ClientAcknowledgePrediction(PredictionKey, bCanDrop);
+	}
 }
 
-bool ASurvivalCharacter::ServerDropItem_Validate(UItem* Item, const int32 Quantity)
+bool ASurvivalCharacter::ServerDropItem_Validate(UItem* Item, const int32 Quantity, const int32 PredictionKey)
 {
 	return true;
 }
 
+ALootBag* ASurvivalCharacter::DropLootBag()
+{
+	if (!HasAuthority() || !PlayerInventory || !LootBagClass || PlayerInventory->GetItems().Num() == 0)
+	{
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.bNoFail = true;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	FVector SpawnLocation = GetActorLocation();
+	SpawnLocation.Z -= GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+
+	ALootBag* LootBag = GetWorld()->SpawnActor<ALootBag>(LootBagClass, FTransform(GetActorRotation(), SpawnLocation), SpawnParams);
+	LootBag->TakeInventory(PlayerInventory);
+
+	return LootBag;
+}
+
+void ASurvivalCharacter::TakeFromLootBag(ALootBag* LootBag, const int32 Index)
+{
+	if (Role < ROLE_Authority)
+	{
+		ServerTakeFromLootBag(LootBag, Index);
+		return;
+	}
+
+	// The bag checks we are still close enough to it
+	if (LootBag)
+	{
+		LootBag->TakeItem(this, Index);
+	}
+}
+
+void ASurvivalCharacter::ServerTakeFromLootBag_Implementation(ALootBag* LootBag, const int32 Index)
+{
+	TakeFromLootBag(LootBag, Index);
+}
+
+bool ASurvivalCharacter::ServerTakeFromLootBag_Validate(ALootBag* LootBag, const int32 Index)
+{
+	return Index >= 0;
+}
+
+void ASurvivalCharacter::ClientReceiveLootBagContents_Implementation(ALootBag* LootBag, const TArray<FPickupItem>& Contents)
+{
+	if (LootBag)
+	{
+		LootBag->SetClientContents(Contents);
+		OnLootBagOpened.Broadcast(LootBag);
+	}
+}
+
 bool ASurvivalCharacter::EquipItem(UEquippableItem* Item)
 {
 	EquippedItems.Add(Item->Slot, Item);
@@ -264,13 +499,8 @@ void ASurvivalCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	//const bool bIsInteractingOnServer = (HasAuthority() && IsInteracting());
-
-
-	if (GetWorld()->TimeSince(InteractionData.LastInteractionCheckTime) > InteractionCheckFrequency)
-	{
-		PerformInteractionCheck();
-	}
+	// Only ticks for the local player, every InteractionCheckFrequency seconds. The server checks when they press interact
+	PerformInteractionCheck();
 }
 
 // Called to bind functionality to input
@@ -303,49 +533,222 @@ void ASurvivalCharacter::PerformInteractionCheck()
 
 	InteractionData.LastInteractionCheckTime = GetWorld()->GetTimeSeconds();
 
+	FInteractionTarget Target;
+
+	if (!FindInteractionTarget(Target))
+	{
+		// Forget any trace still in flight, its result is out of date now
+		InteractionTraceHandle = FTraceHandle();
+
+		if (GetInteractable())
+		{
+			CouldntFindInteractable();
+		}
+
+		return;
+	}
+
+	FCollisionQueryParams QueryParams;
+	QueryParams.AddIgnoredActor(this);
+
+	// A newer trace replaces any still in flight, so only the latest result gets applied
+	PendingInteractionTarget = Target;
+	InteractionTraceHandle = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Target.ViewLocation, Target.TargetLocation, ECC_Visibility, QueryParams, FCollisionResponseParams::DefaultResponseParam, &InteractionTraceDelegate);
+}
+
+void ASurvivalCharacter::OnInteractionTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceData)
+{
+	if (TraceHandle != InteractionTraceHandle)
+	{
+		return;
+	}
+
+	InteractionTraceHandle = FTraceHandle();
+
+	// Either nothing is in the way, or the first thing in the way is the target itself
+	const bool bVisible = TraceData.OutHits.Num() == 0 || TraceData.OutHits[0].GetActor() == PendingInteractionTarget.TargetActor.Get();
+	ApplyInteractionTarget(PendingInteractionTarget, bVisible);
+}
+
+bool ASurvivalCharacter::FindInteractionTarget(FInteractionTarget& OutTarget) const
+{
+	// Nothing near us, so there's nothing we could be looking at
+	if (!GetController() || (InteractionCandidates.Num() == 0 && NearbyWorldItemCells.Num() == 0))
+	{
+		return false;
+	}
+
 	FVector EyesLoc;
 	FRotator EyesRot;
 
 	// Get location of players camera
 	GetController()->GetPlayerViewPoint(EyesLoc, EyesRot);
 
-	// Figure out where the player's camera is at some point in the distance
-	FVector TraceStart = EyesLoc;
-	FVector TraceEnd = (EyesRot.Vector() * InteractionCheckDistance) + TraceStart;
-	FHitResult TraceHit;
+	const FVector ViewDirection = EyesRot.Vector();
 
-	FCollisionQueryParams QueryParams;
-	QueryParams.AddIgnoredActor(this);
+	// Score everything near us on how directly we are looking at it, and take the best
+	UInteractionComponent* BestInteractable = nullptr;
+	FVector BestInteractableLocation = FVector::ZeroVector;
+	float BestInteractableScore = -1.f;
 
-	// Cast a ray
-	if (GetWorld()->LineTraceSingleByChannel(TraceHit, TraceStart, TraceEnd, ECC_Visibility, QueryParams))
+	for (UInteractionComponent* Candidate : InteractionCandidates)
 	{
-		// Check if we hit an object
-		if (TraceHit.GetActor())
+		if (!Candidate || !Candidate->IsActive() || !Candidate->GetOwner() || !Candidate->GetOwner()->GetRootComponent())
 		{
-			// Check if that object has an interaction component on it
-			if (UInteractionComponent* InteractionComponent = Cast<UInteractionComponent>(TraceHit.GetActor()->GetComponentByClass(UInteractionComponent::StaticClass())))
-			{
-				float Distance = (TraceStart - TraceHit.ImpactPoint).Size();
+			continue;
+		}
 
-				// Don't do anything if we are looking at the same component as the last frame
-				if (InteractionComponent != GetInteractable() && Distance <= InteractionComponent->InteractionDistance)
-				{
-					FoundNewInteractable(InteractionComponent);
-				}
-				else if (Distance > InteractionComponent->InteractionDistance && GetInteractable()) 
-				{
-					CouldntFindInteractable();
-				}
+		const FBoxSphereBounds& Bounds = Candidate->GetOwner()->GetRootComponent()->Bounds;
+		const float Distance = FMath::Sqrt(Bounds.GetBox().ComputeSquaredDistanceToPoint(EyesLoc));
+		const float Score = ScoreInteractionTarget(EyesLoc, ViewDirection, Bounds.Origin, Distance, Candidate->InteractionDistance);
 
-				return;
+		if (Score > BestInteractableScore)
+		{
+			BestInteractable = Candidate;
+			BestInteractableLocation = Bounds.Origin;
+			BestInteractableScore = Score;
+		}
+	}
+
+	// Instanced world items need turning into a pickup actor before we can interact with them
+	AWorldItemCell* BestCell = nullptr;
+	const FWorldItemEntry* BestEntry = nullptr;
+	float BestEntryScore = -1.f;
+
+	for (AWorldItemCell* Cell : NearbyWorldItemCells)
+	{
+		if (!Cell)
+		{
+			continue;
+		}
+
+		for (const FWorldItemEntry& Entry : Cell->GetItems())
+		{
+			const float Score = ScoreInteractionTarget(EyesLoc, ViewDirection, Entry.Location, FVector::Dist(EyesLoc, Entry.Location), WorldItemFocusDistance);
+
+			if (Score > BestEntryScore)
+			{
+				BestCell = Cell;
+				BestEntry = &Entry;
+				BestEntryScore = Score;
 			}
 		}
 	}
 
+	OutTarget.ViewLocation = EyesLoc;
+
+	if (BestEntry && BestEntryScore > BestInteractableScore)
+	{
+		OutTarget.Cell = BestCell;
+		OutTarget.ItemId = BestEntry->ItemId;
+		OutTarget.TargetLocation = BestEntry->Location;
+		OutTarget.TargetActor = BestCell;
+		return true;
+	}
+	
+	if (BestInteractable)
+	{
+		OutTarget.Interactable = BestInteractable;
+		OutTarget.TargetLocation = BestInteractableLocation;
+		OutTarget.TargetActor = BestInteractable->GetOwner();
+		return true;
+	}
+
+	return false;
+}
+
+void ASurvivalCharacter::ApplyInteractionTarget(const FInteractionTarget& Target, const bool bVisible)
+{
+	if (bVisible && Target.Cell.IsValid())
+	{
+		RequestWorldItemPromotion(Target.Cell.Get(), Target.ItemId);
+	}
+	else if (bVisible && Target.Interactable.IsValid())
+	{
+		// Don't do anything if we are looking at the same component as the last check
+		if (Target.Interactable.Get() != GetInteractable())
+		{
+			FoundNewInteractable(Target.Interactable.Get());
+		}
+
+		return;
+	}
+
 	CouldntFindInteractable();
 }
 
+float ASurvivalCharacter::ScoreInteractionTarget(const FVector& ViewLocation, const FVector& ViewDirection, const FVector& TargetLocation, const float Distance, const float MaxDistance) const
+{
+	if (Distance > MaxDistance)
+	{
+		return -1.f;
+	}
+
+	const float Dot = FVector::DotProduct(ViewDirection, (TargetLocation - ViewLocation).GetSafeNormal());
+	return Dot >= FMath::Cos(FMath::DegreesToRadians(InteractionViewConeAngle)) ? Dot : -1.f;
+}
+
+bool ASurvivalCharacter::IsInteractionTargetVisible(const FVector& ViewLocation, const FVector& TargetLocation, const AActor* TargetActor) const
+{
+	FCollisionQueryParams QueryParams;
+	QueryParams.AddIgnoredActor(this);
+
+	FHitResult TraceHit;
+
+	// Either nothing is in the way, or the first thing in the way is the target itself
+	return !GetWorld()->LineTraceSingleByChannel(TraceHit, ViewLocation, TargetLocation, ECC_Visibility, QueryParams) || TraceHit.GetActor() == TargetActor;
+}
+
+void ASurvivalCharacter::RequestWorldItemPromotion(AWorldItemCell* Cell, const int32 ItemId)
+{
+	if (!Cell || ItemId == INDEX_NONE)
+	{
+		return;
+	}
+
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+
+	if (LastPromotionRequestCell.Get() != Cell || LastPromotionRequestItemId != ItemId || TimeSeconds - LastPromotionRequestTime > PromotionRetryTime)
+	{
+		LastPromotionRequestCell = Cell;
+		LastPromotionRequestItemId = ItemId;
+		LastPromotionRequestTime = TimeSeconds;
+
+		if (HasAuthority())
+		{
+			ServerPromoteWorldItem_Implementation(Cell, ItemId);
+		}
+		else
+		{
+			ServerPromoteWorldItem(Cell, ItemId);
+		}
+	}
+}
+
+void ASurvivalCharacter::ServerPromoteWorldItem_Implementation(AWorldItemCell* Cell, const int32 ItemId)
+{
+	UWorldItemManagerComponent* WorldItemManager = UWorldItemManagerComponent::Get(this);
+
+	if (!WorldItemManager || !Cell)
+	{
+		return;
+	}
+
+	// Only promote items the player could actually be looking at
+	if (const FWorldItemEntry* Entry = Cell->FindItem(ItemId))
+	{
+		if (FVector::DistSquared(GetActorLocation(), Entry->Location) <= FMath::Square(InteractionCheckDistance))
+		{
+			WorldItemManager->PromoteWorldItem(Cell, ItemId);
+		}
+	}
+}
+
+bool ASurvivalCharacter::ServerPromoteWorldItem_Validate(AWorldItemCell* Cell, const int32 ItemId)
+{
+	return true;
+}
+
 void ASurvivalCharacter::CouldntFindInteractable()
 {
 	// We have lost focus on an interactable. Clear the timer.
@@ -385,14 +788,36 @@ void ASurvivalCharacter::BeginInteract()
 {
 	if (!HasAuthority()) 
 	{
-		ServerBeginInteract();
+		ServerBeginInteract(GetInteractable(), GetInteractClockTime());
 	}
 
-	if (HasAuthority())
+	StartInteracting(GetInteractClockTime());
+}
+
+float ASurvivalCharacter::GetInteractClockTime() const
+{
+	if (const AGameStateBase* GameState = GetWorld()->GetGameState())
 	{
-		PerformInteractionCheck();
+		float ServerTime = GameState->GetServerWorldTimeSeconds();
+
+		// The replicated server time is a one way trip old by the time a client gets it, so clients run about half their ping
+		// behind the server. Without this the server would credit a client with a whole round trip of head start
+		if (!HasAuthority())
+		{
+			if (const APlayerState* PS = GetPlayerState())
+			{
+				ServerTime += PS->ExactPing * 0.5f / 1000.f;
+			}
+		}
+
+		return ServerTime;
 	}
 
+	return GetWorld()->GetTimeSeconds();
+}
+
+void ASurvivalCharacter::StartInteracting(const float StartTime)
+{
 	InteractionData.bInteractHeld = true;
 
 	if (UInteractionComponent* Interactable = GetInteractable())
@@ -405,7 +830,50 @@ void ASurvivalCharacter::BeginInteract()
 		}
 		else
 		{
-			GetWorldTimerManager().SetTimer(TimerHandle_Interact, this, &ASurvivalCharacter::Interact, Interactable->InteractionTime, false);
+			// Take off however long interact has already been held, so the client and server finish together
+			const float HeldTime = FMath::Clamp(GetInteractClockTime() - StartTime, 0.f, Interactable->InteractionTime);
+			const float RemainingTime = Interactable->InteractionTime - HeldTime;
+
+			if (RemainingTime <= KINDA_SMALL_NUMBER)
+			{
+				Interact();
+			}
+			else
+			{
+				GetWorldTimerManager().SetTimer(TimerHandle_Interact, this, &ASurvivalCharacter::Interact, RemainingTime, false);
+			}
+		}
+	}
+}
+
+void ASurvivalCharacter::FinishServerInteractionCheck(const FInteractionTarget& Target, const bool bVisible)
+{
+	const bool bStartInteracting = bServerInteractPending;
+	const bool bEndInteracting = bServerInteractReleasedWhilePending;
+
+	bServerInteractPending = false;
+	bServerInteractReleasedWhilePending = false;
+
+	// Remember we could see it, so pressing interact on it again doesn't need another trace
+	if (bVisible && Target.Interactable.IsValid())
+	{
+		ServerSightInteractable = Target.Interactable;
+		ServerSightViewLocation = Target.ViewLocation;
+		ServerSightTime = GetWorld()->GetTimeSeconds();
+	}
+
+	ApplyInteractionTarget(Target, bVisible);
+
+	if (bStartInteracting)
+	{
+		// Credit the client for the time its request spent getting here, but only up to MaxInteractLatencyCredit
+		const float Now = GetInteractClockTime();
+		StartInteracting(FMath::Clamp(ServerInteractClientStartTime, Now - MaxInteractLatencyCredit, Now));
+
+		// A quick tap still gets an instant interaction, but anything with an interaction time is cancelled
+		if (bEndInteracting)
+		{
+			EndInteract();
 		}
 	}
 }
@@ -439,6 +907,12 @@ void ASurvivalCharacter::Interact()
 
 void ASurvivalCharacter::ServerEndInteract_Implementation()
 {
+	if (bServerInteractPending)
+	{
+		bServerInteractReleasedWhilePending = true;
+		return;
+	}
+
 	EndInteract();
 }
 
@@ -447,12 +921,87 @@ bool ASurvivalCharacter::ServerEndInteract_Validate()
 	return true;
 }
 
-void ASurvivalCharacter::ServerBeginInteract_Implementation()
+void ASurvivalCharacter::ServerBeginInteract_Implementation(UInteractionComponent* Interactable, const float StartTime)
 {
-	BeginInteract();
+	bServerInteractPending = true;
+	bServerInteractReleasedWhilePending = false;
+	ServerInteractClientStartTime = StartTime;
+
+	// Any check still running for an earlier request is out of date now
+	++ServerInteractRequestSerial;
+
+	FInteractionTarget Target;
+	const EInteractValidation Validation = ValidateInteractRequest(Interactable, Target);
+	Target.RequestSerial = ServerInteractRequestSerial;
+
+	switch (Validation)
+	{
+	case EInteractValidation::Accepted:
+		INC_DWORD_STAT(STAT_InteractsAccepted);
+		FinishServerInteractionCheck(Target, true);
+		return;
+	case EInteractValidation::Rejected:
+		INC_DWORD_STAT(STAT_InteractsRejected);
+		FinishServerInteractionCheck(FInteractionTarget(), false);
+		return;
+	default:
+		INC_DWORD_STAT(STAT_InteractsNeedingTrace);
+		break;
+	}
+
+	// Trace to it along with everyone else who pressed interact this frame
+	ServerInteractTarget = Target;
+
+	if (UInteractionSchedulerComponent* InteractionScheduler = UInteractionSchedulerComponent::Get(this))
+	{
+		InteractionScheduler->QueueInteractionCheck(this);
+		return;
+	}
+
+	FinishServerInteractionCheck(Target, IsInteractionTargetVisible(Target.ViewLocation, Target.TargetLocation, Target.TargetActor.Get()));
 }
 
-bool ASurvivalCharacter::ServerBeginInteract_Validate()
+bool ASurvivalCharacter::ServerBeginInteract_Validate(UInteractionComponent* Interactable, const float StartTime)
 {
 	return true;
-}
\ No newline at end of file
+}
+
+EInteractValidation ASurvivalCharacter::ValidateInteractRequest(UInteractionComponent* Interactable, FInteractionTarget& OutTarget) const
+{
+	if (!Interactable || !Interactable->IsActive() || !GetController() || !Interactable->GetOwner() || !Interactable->GetOwner()->GetRootComponent())
+	{
+		return EInteractValidation::Rejected;
+	}
+
+	FVector EyesLoc;
+	FRotator EyesRot;
+
+	GetController()->GetPlayerViewPoint(EyesLoc, EyesRot);
+
+	const FBoxSphereBounds& Bounds = Interactable->GetOwner()->GetRootComponent()->Bounds;
+	const float Distance = FMath::Sqrt(Bounds.GetBox().ComputeSquaredDistanceToPoint(EyesLoc));
+
+	OutTarget.Interactable = Interactable;
+	OutTarget.ViewLocation = EyesLoc;
+	OutTarget.TargetLocation = Bounds.Origin;
+	OutTarget.TargetActor = Interactable->GetOwner();
+
+	if (Distance > Interactable->InteractionDistance + ServerInteractDistanceTolerance)
+	{
+		return EInteractValidation::Rejected;
+	}
+
+	// The servers view rotation lags behind the clients, so this only catches players who clearly weren't looking at it
+	const FVector ToTarget = (Bounds.Origin - EyesLoc).GetSafeNormal();
+
+	if (Distance > 0.f && FVector::DotProduct(EyesRot.Vector(), ToTarget) < FMath::Cos(FMath::DegreesToRadians(ServerInteractViewAngle)))
+	{
+		return EInteractValidation::Rejected;
+	}
+
+	const bool bSightStillValid = ServerSightInteractable.Get() == Interactable
+		&& GetWorld()->TimeSince(ServerSightTime) <= ServerSightCacheTime
+		&& FVector::DistSquared(ServerSightViewLocation, EyesLoc) <= FMath::Square(ServerSightCacheDistance);
+
+	return bSightStillValid ? EInteractValidation::Accepted : EInteractValidation::NeedsTrace;
+}
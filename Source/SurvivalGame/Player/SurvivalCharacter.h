@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "World/Pickup.h"
+#include "WorldCollision.h"
 #include "SurvivalCharacter.generated.h"
 
 USTRUCT()
@@ -31,13 +33,52 @@ struct FInteractionData
 	bool bInteractHeld;
 };
 
+// The best thing we found to interact with, and where to trace from and to so we can check nothing is in the way
+struct FInteractionTarget
+{
+	FInteractionTarget()
+	{
+		ItemId = INDEX_NONE;
+		ViewLocation = FVector::ZeroVector;
+		TargetLocation = FVector::ZeroVector;
+		RequestSerial = 0;
+	}
+
+	TWeakObjectPtr<class UInteractionComponent> Interactable;
+
+	// Set instead of Interactable when the best target is an instanced world item
+	TWeakObjectPtr<class AWorldItemCell> Cell;
+	int32 ItemId;
+
+	FVector ViewLocation;
+	FVector TargetLocation;
+
+	// The actor the trace is allowed to hit
+	TWeakObjectPtr<AActor> TargetActor;
+
+	// [server] Which interact request this target is for. A check for an older request is ignored when it finishes
+	int32 RequestSerial;
+};
+
+// What the server made of an interactable a client asked to interact with
+enum class EInteractValidation : uint8
+{
+	Accepted,
+	Rejected,
+	// The cheap checks couldn't tell, so the server has to trace to it
+	NeedsTrace
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnEquippedItemsChanged, const EEquippableSlot, Slot, const UEquippableItem*, Item);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnLootBagOpened, class ALootBag*, LootBag);
 
 UCLASS()
 class SURVIVALGAME_API ASurvivalCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
+	friend class UInteractionSchedulerComponent;
+
 public:
 	// Sets default values for this character's properties
 	ASurvivalCharacter();
@@ -56,6 +97,10 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Components")
 	class UCameraComponent* CameraComponent;
 
+	// Keeps track of the interactables near us, so we only have to look through those when checking what we're looking at
+	UPROPERTY(EditAnywhere, Category = "Components")
+	class USphereComponent* InteractionSphere;
+
 	UPROPERTY(EditAnywhere, Category = "Components")
 	class USkeletalMeshComponent* HelmetMesh;
 
@@ -80,27 +125,147 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
-	// Called every frame
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// Called every InteractionCheckFrequency seconds, for the local player only
 	virtual void Tick(float DeltaTime) override;
 
+	virtual void PossessedBy(AController* NewController) override;
+	virtual void UnPossessed() override;
+	virtual void PawnClientRestart() override;
+
 	// How often in seconds to check for an interactable object. Set this to zero if you want to check every tick.
 	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
 	float InteractionCheckFrequency;
 
-	// How far we will trace when we check if the player is looking at an interactable object
+	// How close an interactable has to be before we consider whether we are looking at it. This is the radius of the interaction sphere
 	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
 	float InteractionCheckDistance;
 
+	// How far from the middle of the screen, in degrees, an interactable can be and still be focused
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (ClampMin = 0.0, ClampMax = 90.0))
+	float InteractionViewConeAngle;
+
+	// How close an instanced world item needs to be before looking at it turns it into a pickup we can interact with
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
+	float WorldItemFocusDistance;
+
+	// Find what we are looking at, and issue an async trace to check nothing is in the way. The result is applied next frame
 	void PerformInteractionCheck();
 
+	// Score everything near us on how directly we are looking at it. Returns false if nothing is worth tracing to
+	bool FindInteractionTarget(FInteractionTarget& OutTarget) const;
+
+	// Focus the target we found, or lose focus if it turned out to be hidden
+	void ApplyInteractionTarget(const FInteractionTarget& Target, const bool bVisible);
+
+	void OnInteractionTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceData);
+
+	FTraceDelegate InteractionTraceDelegate;
+
+	// The trace we are waiting on, and the target it is for
+	FTraceHandle InteractionTraceHandle;
+	FInteractionTarget PendingInteractionTarget;
+
+	// How far past an interactables InteractionDistance the server still accepts an interact, to allow for movement lag
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
+	float ServerInteractDistanceTolerance;
+
+	// How far off the servers idea of where the player is looking an interactable can be, in degrees, before it's rejected
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (ClampMin = 0.0, ClampMax = 180.0))
+	float ServerInteractViewAngle;
+
+	// How long the server trusts a line of sight trace to an interactable, as long as the player hasn't moved far
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
+	float ServerSightCacheTime;
+
+	// How far the player can move from where that trace was done before the server traces again
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
+	float ServerSightCacheDistance;
+
+	// [server] Check the interactable a client wants to interact with is in range and roughly in view. Fills in the target to trace to
+	EInteractValidation ValidateInteractRequest(class UInteractionComponent* Interactable, FInteractionTarget& OutTarget) const;
+
+	// [server] The target the interaction scheduler should trace to
+	FInteractionTarget ServerInteractTarget;
+
+	// [server] Goes up with every interact request, so checks still running for an earlier request can be told apart
+	int32 ServerInteractRequestSerial;
+
+	// [server] The interactable we last traced to and could see, and where from
+	TWeakObjectPtr<class UInteractionComponent> ServerSightInteractable;
+	FVector ServerSightViewLocation;
+	float ServerSightTime;
+
+	// [server] Called by the interaction scheduler once a check a player asked for has finished
+	void FinishServerInteractionCheck(const FInteractionTarget& Target, const bool bVisible);
+
+	// True while the server is waiting on an interaction check before it starts interacting
+	bool bServerInteractPending;
+
+	// True if the player let go of interact before the check finished
+	bool bServerInteractReleasedWhilePending;
+
+	// Only the server and the local player need to know what's near them, and only the local player polls for interactables
+	void UpdateInteractionRole();
+
+	UFUNCTION()
+	void OnInteractionSphereBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
+	UFUNCTION()
+	void OnInteractionSphereEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+
+	// How directly we are looking at a target, from -1 to 1. Returns -1 if the target is out of range or outside the view cone
+	float ScoreInteractionTarget(const FVector& ViewLocation, const FVector& ViewDirection, const FVector& TargetLocation, const float Distance, const float MaxDistance) const;
+
+	// Trace to a target to make sure nothing is in the way
+	bool IsInteractionTargetVisible(const FVector& ViewLocation, const FVector& TargetLocation, const AActor* TargetActor) const;
+
+	// The interactables inside the interaction sphere
+	UPROPERTY()
+	TArray<class UInteractionComponent*> InteractionCandidates;
+
+	// The world item cells with items inside the interaction sphere
+	UPROPERTY()
+	TArray<class AWorldItemCell*> NearbyWorldItemCells;
+
+	// Ask the server to turn an instanced world item we are looking at into a pickup actor
+	void RequestWorldItemPromotion(class AWorldItemCell* Cell, const int32 ItemId);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerPromoteWorldItem(class AWorldItemCell* Cell, const int32 ItemId);
+
+	// The world item we last asked the server to promote, so we don't ask again every interaction check
+	TWeakObjectPtr<class AWorldItemCell> LastPromotionRequestCell;
+	int32 LastPromotionRequestItemId;
+	float LastPromotionRequestTime;
+
+	// If the item we asked to promote is still in its cell after this long, the server didn't promote it so ask again
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (ClampMin = 0.0))
+	float PromotionRetryTime;
+
 	void CouldntFindInteractable();
 	void FoundNewInteractable(UInteractionComponent* Interactable);
 
 	void BeginInteract();
 	void EndInteract();
 
+	// Start interacting with whatever we are focused on. StartTime is when interact was pressed, on the interact clock
+	void StartInteracting(const float StartTime);
+
+	// The servers world time. Clients get this from the game state plus half their ping, so both sides agree on when an interaction started
+	float GetInteractClockTime() const;
+
+	// How much of a clients head start on a timed interaction the server will credit, in seconds. This covers latency
+	// without letting clients skip the interaction time
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (ClampMin = 0.0))
+	float MaxInteractLatencyCredit;
+
+	// [server] When the client says it pressed interact
+	float ServerInteractClientStartTime;
+
+	// Interactable is what the client was focused on when it pressed interact, and StartTime is when, on the interact clock
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerBeginInteract();
+	void ServerBeginInteract(class UInteractionComponent* Interactable, const float StartTime);
 
 	UFUNCTION(Server, Reliable, WithValidation)
 	void ServerEndInteract();
@@ -129,15 +294,38 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Items")
 	void DropItem(class UItem* Item, int32 Quantity);
 
+	// PredictionKey is the key the client applied the action locally with, or INDEX_NONE if it didn't predict it
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerUseItem(class UItem* Item);
+	void ServerUseItem(class UItem* Item, const int32 PredictionKey);
 
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerDropItem(class UItem* Item, const int32 Quantity);
+	void ServerDropItem(class UItem* Item, const int32 Quantity, const int32 PredictionKey);
 
 	UPROPERTY(EditDefaultsOnly, Category = "Item")
 	TSubclassOf<class APickup> PickupClass;
 
+	// The bag everything we are carrying goes into when we die
+	UPROPERTY(EditDefaultsOnly, Category = "Item")
+	TSubclassOf<class ALootBag> LootBagClass;
+
+	// [server] Move the whole inventory and all equipped gear into a single loot bag. Call this when the player dies
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Items")
+	class ALootBag* DropLootBag();
+
+	// Take an item out of a loot bag we have opened
+	UFUNCTION(BlueprintCallable, Category = "Items")
+	void TakeFromLootBag(class ALootBag* LootBag, const int32 Index);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerTakeFromLootBag(class ALootBag* LootBag, const int32 Index);
+
+	// Sends the contents of a loot bag to the player that opened it
+	UFUNCTION(Client, Reliable)
+	void ClientReceiveLootBagContents(class ALootBag* LootBag, const TArray<FPickupItem>& Contents);
+
+	UPROPERTY(BlueprintAssignable, Category = "Items")
+	FOnLootBagOpened OnLootBagOpened;
+
 	bool EquipItem(class UEquippableItem* Item);
 	bool UnEquipItem(class UEquippableItem* Item);
 
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SurvivalHUD.h"
+#include "Components/InteractionPromptComponent.h"
+#include "Widgets/InteractionWidget.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+
+ASurvivalHUD::ASurvivalHUD()
+{
+	InteractionPrompt = CreateDefaultSubobject<UInteractionPromptComponent>("InteractionPrompt");
+	SetRootComponent(InteractionPrompt);
+
+	// AHUD hides itself by default, which would hide the prompt along with it
+	SetActorHiddenInGame(false);
+}
+
+void ASurvivalHUD::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// A widget class set straight on the prompt component wins over the configured one
+	TSubclassOf<UUserWidget> WidgetClass = InteractionPrompt->GetWidgetClass();
+
+	if (!WidgetClass)
+	{
+		WidgetClass = InteractionWidgetClass.LoadSynchronous();
+	}
+
+	InteractionPrompt->SetDefaultWidgetClass(WidgetClass);
+
+	if (!WidgetClass)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s has no InteractionWidgetClass, so only interactables with their own widget class will show a prompt."), *GetName());
+	}
+}
+
+ASurvivalHUD* ASurvivalHUD::Get(const APawn* Pawn)
+{
+	if (const APlayerController* PC = Pawn ? Cast<APlayerController>(Pawn->GetController()) : nullptr)
+	{
+		ASurvivalHUD* SurvivalHUD = Cast<ASurvivalHUD>(PC->GetHUD());
+
+		// Interaction prompts need an ASurvivalHUD, so warn once if the game mode is using some other HUD
+		static bool bWarnedWrongHUD = false;
+
+		if (!SurvivalHUD && PC->GetHUD() && !bWarnedWrongHUD)
+		{
+			bWarnedWrongHUD = true;
+			UE_LOG(LogTemp, Warning, TEXT("%s is not an ASurvivalHUD, so no interaction prompts will show. Make your HUD blueprint a child of SurvivalHUD."), *PC->GetHUD()->GetClass()->GetName());
+		}
+
+		return SurvivalHUD;
+	}
+
+	return nullptr;
+}
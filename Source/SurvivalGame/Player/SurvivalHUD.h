@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/HUD.h"
+#include "SurvivalHUD.generated.h"
+
+/**
+ * Owns the one interaction prompt the local player sees. Interactables only hold their interaction data, so there is
+ * no widget for every pickup in the world. HUDs only exist for local players, so a dedicated server never creates the prompt.
+ * 
+ * The prompts widget comes from InteractionWidgetClass, which can be set in DefaultGame.ini under
+ * [/Script/SurvivalGame.SurvivalHUD] or on a blueprint child of this HUD.
+ */
+UCLASS(Config = Game)
+class SURVIVALGAME_API ASurvivalHUD : public AHUD
+{
+	GENERATED_BODY()
+
+public:
+
+	ASurvivalHUD();
+
+	// The HUD of the player controlling a character, if they are a local player
+	static ASurvivalHUD* Get(const class APawn* Pawn);
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	class UInteractionPromptComponent* InteractionPrompt;
+
+	// The widget the prompt uses for interactables that don't set their own
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Interaction")
+	TSoftClassPtr<class UInteractionWidget> InteractionWidgetClass;
+
+protected:
+
+	virtual void BeginPlay() override;
+
+};
@@ -10,7 +10,13 @@ public class SurvivalGame : ModuleRules
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore" });
 
-		PrivateDependencyModuleNames.AddRange(new string[] {  });
+		// Push model lives in NetCore, which only exists from 4.25. Older engines leave WITH_PUSH_MODEL at 0, see SurvivalGame.h
+		if (Target.Version.MajorVersion > 4 || Target.Version.MinorVersion >= 25)
+		{
+			PublicDependencyModuleNames.Add("NetCore");
+		}
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "ReplicationGraph" });
 
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
@@ -4,3 +4,36 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_STATS_GROUP(TEXT("SurvivalGame"), STATGROUP_SurvivalGame, STATCAT_Advanced);
+
+// Push model replication is only available on engine versions that define this, older versions compare every property as normal
+#ifndef WITH_PUSH_MODEL
+#define WITH_PUSH_MODEL 0
+#endif
+
+#if WITH_PUSH_MODEL
+#include "Net/Core/PushModel/PushModel.h"
+
+// Tell the replication system a push based property has changed and needs comparing on the next net update
+#define SURVIVAL_MARK_PROPERTY_DIRTY(ClassName, PropertyName, Object) MARK_PROPERTY_DIRTY_FROM_NAME(ClassName, PropertyName, Object)
+
+// Register a property for replication that will only be compared after it has been marked dirty
+#define SURVIVAL_DOREPLIFETIME_PUSH(ClassName, PropertyName) \
+	{ \
+		FDoRepLifetimeParams PushParams; \
+		PushParams.bIsPushBased = true; \
+		DOREPLIFETIME_WITH_PARAMS_FAST(ClassName, PropertyName, PushParams); \
+	}
+
+#define SURVIVAL_DOREPLIFETIME_PUSH_CONDITION(ClassName, PropertyName, Condition) \
+	{ \
+		FDoRepLifetimeParams PushParams; \
+		PushParams.bIsPushBased = true; \
+		PushParams.Condition = Condition; \
+		DOREPLIFETIME_WITH_PARAMS_FAST(ClassName, PropertyName, PushParams); \
+	}
+#else
+#define SURVIVAL_MARK_PROPERTY_DIRTY(ClassName, PropertyName, Object)
+#define SURVIVAL_DOREPLIFETIME_PUSH(ClassName, PropertyName) DOREPLIFETIME(ClassName, PropertyName)
+#define SURVIVAL_DOREPLIFETIME_PUSH_CONDITION(ClassName, PropertyName, Condition) DOREPLIFETIME_CONDITION(ClassName, PropertyName, Condition)
+#endif
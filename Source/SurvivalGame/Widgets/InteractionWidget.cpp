@@ -8,4 +8,11 @@ void UInteractionWidget::UpdateInteractionWidget(class UInteractionComponent* In
 {
 	OwningInteractionComponent = InteractionComponent;
 	OnUpdateInteractionWidget();
-}
\ No newline at end of file
+}
+
+void UInteractionWidget::SetInteractProgress(const float StartTime, const float Duration)
+{
+	InteractStartTime = StartTime;
+	InteractDuration = Duration;
+	OnInteractProgressChanged();
+}
@@ -23,4 +23,20 @@ public:
 
 	UPROPERTY(BlueprintReadOnly, Category = "Interaction", meta = (ExposeOnSpawn))
 	class UInteractionComponent* OwningInteractionComponent;
+
+	UFUNCTION(BlueprintCallable, Category = "Interaction")
+	void SetInteractProgress(const float StartTime, const float Duration);
+
+	// Called when the local player starts or stops interacting. Play a progress animation from InteractStartTime over
+	// InteractDuration here instead of binding to GetInteractPercentage, so the widget doesn't need to update every frame
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnInteractProgressChanged();
+
+	// The world time the local player started interacting, or -1 if they aren't interacting
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	float InteractStartTime;
+
+	// How long the interaction takes from InteractStartTime to finish
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	float InteractDuration;
 };
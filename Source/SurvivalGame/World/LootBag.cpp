@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LootBag.h"
+#include "Items/Item.h"
+#include "Player/SurvivalCharacter.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/InteractionComponent.h"
+#include "Components/InventoryComponent.h"
+
+#define LOCTEXT_NAMESPACE "LootBag"
+
+ALootBag::ALootBag()
+{
+	BagMesh = CreateDefaultSubobject<UStaticMeshComponent>("BagMesh");
+	BagMesh->SetCollisionResponseToChannel(ECC_Pawn, ECR_Ignore);
+
+	SetRootComponent(BagMesh);
+
+	InteractionComponent = CreateDefaultSubobject<UInteractionComponent>("LootBagInteractionComponent");
+	InteractionComponent->InteractionTime = 0.f;
+	InteractionComponent->InteractionDistance = 200.f;
+	InteractionComponent->InteractableNameText = LOCTEXT("LootBagName", "Loot Bag");
+	InteractionComponent->InteractableActionText = LOCTEXT("LootBagAction", "search");
+	InteractionComponent->OnInteract.AddDynamic(this, &ALootBag::OnOpenBag);
+
+	TakeDistanceTolerance = 100.f;
+
+	SetReplicates(true);
+}
+
+void ALootBag::TakeInventory(UInventoryComponent* Inventory)
+{
+	if (HasAuthority() && Inventory)
+	{
+		for (UItem* Item : Inventory->RemoveAllItems())
+		{
+			if (Item && Item->GetQuantity() > 0)
+			{
+				Contents.Add(FPickupItem(Item->GetClass(), Item->GetQuantity()));
+			}
+		}
+
+		SendContentsToViewers();
+	}
+}
+
+void ALootBag::TakeItem(ASurvivalCharacter* Taker, const int32 Index)
+{
+	if (!HasAuthority() || IsPendingKillPending() || !Taker || !Taker->PlayerInventory || !Contents.IsValidIndex(Index))
+	{
+		return;
+	}
+
+	// Only players that opened the bag and haven't walked away from it can take from it
+	if (!Viewers.Contains(Taker))
+	{
+		return;
+	}
+
+	if (!IsViewerInRange(Taker))
+	{
+		Viewers.Remove(Taker);
+		return;
+	}
+
+	FPickupItem& Entry = Contents[Index];
+	const FItemAddResult AddResult = Taker->PlayerInventory->TryAddItemFromClass(Entry.ItemClass, Entry.Quantity);
+
+	if (AddResult.ActualAmountGiven <= 0)
+	{
+		return;
+	}
+
+	Entry.Quantity -= AddResult.ActualAmountGiven;
+
+	if (Entry.Quantity <= 0)
+	{
+		Contents.RemoveAt(Index);
+	}
+
+	if (Contents.Num() == 0)
+	{
+		Destroy();
+		return;
+	}
+
+	SendContentsToViewers();
+}
+
+void ALootBag::SetClientContents(const TArray<FPickupItem>& NewContents)
+{
+	Contents = NewContents;
+	OnContentsUpdated.Broadcast();
+}
+
+void ALootBag::OnOpenBag(ASurvivalCharacter* Character)
+{
+	if (HasAuthority() && Character)
+	{
+		Viewers.AddUnique(Character);
+		Character->ClientReceiveLootBagContents(this, Contents);
+	}
+}
+
+void ALootBag::SendContentsToViewers()
+{
+	for (int32 i = Viewers.Num() - 1; i >= 0; --i)
+	{
+		ASurvivalCharacter* Viewer = Viewers[i];
+
+		if (!Viewer || Viewer->IsPendingKillPending() || !IsViewerInRange(Viewer))
+		{
+			Viewers.RemoveAt(i);
+			continue;
+		}
+
+		Viewer->ClientReceiveLootBagContents(this, Contents);
+	}
+}
+
+bool ALootBag::IsViewerInRange(const ASurvivalCharacter* Viewer) const
+{
+	const float MaxTakeDistance = InteractionComponent->InteractionDistance + TakeDistanceTolerance;
+	return Viewer && FVector::DistSquared(Viewer->GetActorLocation(), GetActorLocation()) <= FMath::Square(MaxTakeDistance);
+}
+
+#undef LOCTEXT_NAMESPACE
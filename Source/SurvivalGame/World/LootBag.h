@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Components/InteractableInterface.h"
+#include "World/Pickup.h"
+#include "LootBag.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnLootBagContentsUpdated);
+
+/**
+ * Holds everything a player was carrying when they died, in place of a pickup per item.
+ * Only the bag itself replicates to everyone. Its contents are kept as item class and quantity pairs on the server,
+ * and are only sent to players who open it.
+ */
+UCLASS()
+class SURVIVALGAME_API ALootBag : public AActor, public IInteractableInterface
+{
+	GENERATED_BODY()
+	
+public:	
+	ALootBag();
+
+	// [server] Move everything in an inventory into the bag, including equipped gear, in a single operation
+	void TakeInventory(class UInventoryComponent* Inventory);
+
+	// [server] Give the item at Index to a player who has the bag open and is still within reach of it
+	void TakeItem(class ASurvivalCharacter* Taker, const int32 Index);
+
+	// How far past the interaction distance a player with the bag open can move and still take from it
+	UPROPERTY(EditDefaultsOnly, Category = "Loot Bag", meta = (ClampMin = 0.0))
+	float TakeDistanceTolerance;
+
+	// [local] Called when the server sends us the contents of the bag
+	void SetClientContents(const TArray<FPickupItem>& NewContents);
+
+	// [local] The contents of the bag, if we have opened it
+	UFUNCTION(BlueprintPure, Category = "Loot Bag")
+	FORCEINLINE TArray<FPickupItem> GetContents() const { return Contents; }
+
+	UFUNCTION(BlueprintPure, Category = "Loot Bag")
+	bool IsEmpty() const { return Contents.Num() == 0; }
+
+	UPROPERTY(BlueprintAssignable, Category = "Loot Bag")
+	FOnLootBagContentsUpdated OnContentsUpdated;
+
+	UFUNCTION(BlueprintPure, Category = "Loot Bag")
+	FORCEINLINE class UInteractionComponent* GetInteractionComponent() const { return InteractionComponent; }
+
+	// IInteractableInterface
+	virtual class UInteractionComponent* GetActorInteractionComponent() const override { return InteractionComponent; }
+
+protected:
+
+	// Called when a player opens the bag
+	UFUNCTION()
+	void OnOpenBag(class ASurvivalCharacter* Character);
+
+	// Send the contents to everyone with the bag open, forgetting anybody who has walked away
+	void SendContentsToViewers();
+
+	// Whether a viewer is close enough to keep the bag open
+	bool IsViewerInRange(const class ASurvivalCharacter* Viewer) const;
+
+	// Everything in the bag. On the server this is the real contents, on clients it's the last contents we were sent
+	UPROPERTY()
+	TArray<FPickupItem> Contents;
+
+	// [server] The players who have opened the bag
+	UPROPERTY()
+	TArray<class ASurvivalCharacter*> Viewers;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Components")
+	class UStaticMeshComponent* BagMesh;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Components")
+	class UInteractionComponent* InteractionComponent;
+
+};
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LootSpawnPoint.h"
+#include "Items/LootTable.h"
+#include "Components/LootRespawnComponent.h"
+#include "Components/WorldItemManagerComponent.h"
+
+ALootSpawnPoint::ALootSpawnPoint()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	SetRootComponent(CreateDefaultSubobject<USceneComponent>("Root"));
+
+	RespawnTime = 600.f;
+	RespawnTimeVariance = 120.f;
+	PlayerBlockRadius = 2500.f;
+
+	bRespawnScheduled = false;
+	bHasLoot = false;
+}
+
+void ALootSpawnPoint::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// The first lot of loot is spawned by the respawn component as well, so map load doesn't spawn it all at once
+	if (HasAuthority())
+	{
+		if (ULootRespawnComponent* LootRespawn = ULootRespawnComponent::Get(this))
+		{
+			LootRespawn->ScheduleRespawn(this, 0.f);
+		}
+	}
+}
+
+void ALootSpawnPoint::OnLootTaken()
+{
+	if (HasAuthority() && bHasLoot)
+	{
+		bHasLoot = false;
+
+		if (ULootRespawnComponent* LootRespawn = ULootRespawnComponent::Get(this))
+		{
+			LootRespawn->ScheduleRespawn(this, RespawnTime + FMath::FRand() * RespawnTimeVariance);
+		}
+	}
+}
+
+bool ALootSpawnPoint::TrySpawnLoot(const TArray<FVector>& PlayerLocations)
+{
+	if (bHasLoot)
+	{
+		return true;
+	}
+
+	const float BlockRadiusSquared = FMath::Square(PlayerBlockRadius);
+
+	for (const FVector& PlayerLocation : PlayerLocations)
+	{
+		if (FVector::DistSquared(PlayerLocation, GetActorLocation()) < BlockRadiusSquared)
+		{
+			return false;
+		}
+	}
+
+	const FLootTableEntry* Entry = LootTable ? LootTable->RollEntry() : nullptr;
+	UWorldItemManagerComponent* WorldItemManager = UWorldItemManagerComponent::Get(this);
+
+	if (!Entry || !WorldItemManager)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Loot spawn point %s has no loot table, or there is no world item manager to spawn loot with"), *GetName());
+		return true;
+	}
+
+	const int32 Quantity = FMath::RandRange(Entry->MinQuantity, FMath::Max(Entry->MinQuantity, Entry->MaxQuantity));
+
+	WorldItemManager->AddLevelItem(Entry->ItemClass, Quantity, GetActorTransform(), this);
+	bHasLoot = true;
+
+	return true;
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "LootSpawnPoint.generated.h"
+
+/**
+ * A place in the level that spawns an item from a loot table, and spawns another one a while after it has been taken.
+ * Spawn points don't tick or replicate. Their respawns are scheduled by the loot respawn component on the game state.
+ */
+UCLASS()
+class SURVIVALGAME_API ALootSpawnPoint : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ALootSpawnPoint();
+
+	// The table to roll loot from
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot")
+	class ULootTable* LootTable;
+
+	// How long after the loot is taken before more spawns
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = 0.0))
+	float RespawnTime;
+
+	// A random amount of time up to this is added to RespawnTime, so loot taken at the same time doesn't all come back together
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = 0.0))
+	float RespawnTimeVariance;
+
+	// Loot won't spawn while a player is this close, so it doesn't pop in front of them
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Loot", meta = (ClampMin = 0.0))
+	float PlayerBlockRadius;
+
+	// [server] Called by the pickup when a player takes the loot this spawn point spawned
+	void OnLootTaken();
+
+	// [server] Called by the loot respawn component when the respawn is due. Returns false if the loot couldn't spawn yet
+	bool TrySpawnLoot(const TArray<FVector>& PlayerLocations);
+
+	// Whether the respawn component has a respawn queued for this spawn point
+	bool bRespawnScheduled;
+
+protected:
+
+	virtual void BeginPlay() override;
+
+	// Whether we have loot out in the world that hasn't been taken yet
+	bool bHasLoot;
+
+};
@@ -2,13 +2,47 @@
 
 
 #include "Pickup.h"
+#include "SurvivalGame.h"
 #include "Items/Item.h"
 #include "Net/UnrealNetwork.h"
 #include "Player/SurvivalCharacter.h"
 #include "Components/StaticMeshComponent.h"
 #include "Components/InteractionComponent.h"
 #include "Components/InventoryComponent.h"
-#include "Engine/ActorChannel.h"
+#include "Components/WorldItemManagerComponent.h"
+#include "Components/PickupPoolComponent.h"
+#include "World/LootSpawnPoint.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Dormant Pickups"), STAT_DormantPickups, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Dormancy Flushes"), STAT_PickupDormancyFlushes, STATGROUP_SurvivalGame);
+
+bool FPickupItem::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	UObject* ClassObject = ItemClass.Get();
+
+	if (Map)
+	{
+		bOutSuccess = Map->SerializeObject(Ar, UClass::StaticClass(), ClassObject);
+	}
+	else
+	{
+		Ar << ClassObject;
+		bOutSuccess = true;
+	}
+
+	uint32 PackedQuantity = FMath::Max(Quantity, 0);
+	Ar.SerializeIntPacked(PackedQuantity);
+
+	if (Ar.IsLoading())
+	{
+		ItemClass = Cast<UClass>(ClassObject);
+		Quantity = PackedQuantity;
+	}
+
+	return true;
+}
 
 // Sets default values
 APickup::APickup()
@@ -24,46 +58,119 @@ APickup::APickup()
 	InteractionComponent->InteractableNameText = FText::FromString("Pickup");
 	InteractionComponent->InteractableActionText = FText::FromString("take");
 	InteractionComponent->OnInteract.AddDynamic(this, &APickup::OnTakePickup);
-	InteractionComponent->SetupAttachment(PickupMesh);
 
 	SetReplicates(true);
+
+	// Pickups only change when they are initialized, partially taken or pooled, so they sit dormant the rest of the time
+	// and are woken up by MarkDirtyForReplication
+	NetDormancy = DORM_DormantAll;
+	NetUpdateFrequency = 1.f;
+	bCountedAsDormant = false;
+	DropTime = -1.f;
+	PoolSerial = 0;
+}
+
+void APickup::MarkDirtyForReplication()
+{
+	if (HasAuthority())
+	{
+		// Replicates the change straight away, and flushes the pickup out of dormancy for this one update
+		ForceNetUpdate();
+		INC_DWORD_STAT(STAT_PickupDormancyFlushes);
+	}
 }
 
 void APickup::InitializePickup(const TSubclassOf<class UItem> ItemClass, const int32 Quantity)
 {
 	if (HasAuthority() && ItemClass && Quantity > 0)
 	{
-		Item = NewObject<UItem>(this, ItemClass);
-		Item->SetQuantity(Quantity);
+		const UItem* ItemCDO = ItemClass->GetDefaultObject<UItem>();
+
+		PickupItem.ItemClass = ItemClass;
+		PickupItem.Quantity = FMath::Min(Quantity, ItemCDO->bStackable ? ItemCDO->MaxStackSize : 1);
+		SURVIVAL_MARK_PROPERTY_DIRTY(APickup, PickupItem, this);
+		MarkDirtyForReplication();
+
+		OnRep_PickupItem();
+	}
+}
+
+void APickup::SetQuantity(const int32 NewQuantity)
+{
+	if (HasAuthority() && NewQuantity != PickupItem.Quantity)
+	{
+		PickupItem.Quantity = NewQuantity;
+		SURVIVAL_MARK_PROPERTY_DIRTY(APickup, PickupItem, this);
+		MarkDirtyForReplication();
 
-		OnRep_Item();
-		Item->MarkDirtyForReplication();
+		OnRep_PickupItem();
 	}
 }
 
-void APickup::OnRep_Item()
+void APickup::SetPooled(const bool bNewPooled)
 {
-	if (Item)
+	if (HasAuthority() && bNewPooled != bPooled)
 	{
-		PickupMesh->SetStaticMesh(Item->PickupMesh);
-		InteractionComponent->InteractableNameText = Item->ItemDisplayName;
+		bPooled = bNewPooled;
+		SURVIVAL_MARK_PROPERTY_DIRTY(APickup, bPooled, this);
 
-		// Clients bind to this delegate in order to refresh the interaction widget if item quantity changes
-		Item->OnItemModified.AddDynamic(this, &APickup::OnItemModified);
+		if (bPooled)
+		{
+			++PoolSerial;
+			PickupItem = FPickupItem();
+			SURVIVAL_MARK_PROPERTY_DIRTY(APickup, PickupItem, this);
+			DropTime = -1.f;
+			SpawnPoint = nullptr;
+		}
+
+		// Replicate the pooled state once, the pickup stays dormant either side of it
+		MarkDirtyForReplication();
+
+		OnRep_Pooled();
 	}
+}
 
-	// If any replicated properties on the item are changed, refresh the widget
-	InteractionComponent->RefreshWidget();
+void APickup::OnRep_Pooled()
+{
+	SetActorHiddenInGame(bPooled);
+	SetActorEnableCollision(!bPooled);
+
+	if (bPooled)
+	{
+		InteractionComponent->Deactivate();
+	}
+	else
+	{
+		InteractionComponent->Activate();
+		AlignWithGround();
+	}
 }
 
-void APickup::OnItemModified()
+void APickup::ReleaseOrDestroy()
 {
-	if (InteractionComponent)
+	if (UPickupPoolComponent* PickupPool = UPickupPoolComponent::Get(this))
+	{
+		PickupPool->ReleasePickup(this);
+	}
+	else
 	{
-		InteractionComponent->RefreshWidget();
+		Destroy();
 	}
 }
 
+void APickup::OnRep_PickupItem()
+{
+	// Everything the pickup displays comes from the item class defaults
+	if (const UItem* ItemCDO = PickupItem.ItemClass ? PickupItem.ItemClass->GetDefaultObject<UItem>() : nullptr)
+	{
+		PickupMesh->SetStaticMesh(ItemCDO->PickupMesh);
+		InteractionComponent->InteractableNameText = ItemCDO->ItemDisplayName;
+	}
+
+	// The item or its quantity changed, refresh the widget
+	InteractionComponent->RefreshWidget();
+}
+
 // Called when the game starts or when spawned
 void APickup::BeginPlay()
 {
@@ -71,6 +178,16 @@ void APickup::BeginPlay()
 	
 	if (HasAuthority() && ItemTemplate && bNetStartup)
 	{
+		// Hand level placed pickups over to the world item manager, so they don't each need an actor
+		UWorldItemManagerComponent* WorldItemManager = UWorldItemManagerComponent::Get(this);
+
+		if (WorldItemManager && WorldItemManager->bInstanceWorldItems && WorldItemManager->bInstanceLevelPickups)
+		{
+			WorldItemManager->AddLevelItem(ItemTemplate->GetClass(), ItemTemplate->GetQuantity(), GetActorTransform());
+			Destroy();
+			return;
+		}
+
 		InitializePickup(ItemTemplate->GetClass(), ItemTemplate->GetQuantity());
 	}
 
@@ -79,29 +196,34 @@ void APickup::BeginPlay()
 		AlignWithGround();
 	}
 
-	if (Item)
+	// Nothing changes a pickups dormancy after it spawns, ForceNetUpdate only flushes it for one update
+	if (HasAuthority())
 	{
-		Item->MarkDirtyForReplication();
+		bCountedAsDormant = NetDormancy > DORM_Awake;
+
+		if (bCountedAsDormant)
+		{
+			INC_DWORD_STAT(STAT_DormantPickups);
+		}
 	}
 }
 
-void APickup::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+void APickup::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	Super::EndPlay(EndPlayReason);
 
-	DOREPLIFETIME(APickup, Item);
+	if (HasAuthority() && bCountedAsDormant)
+	{
+		DEC_DWORD_STAT(STAT_DormantPickups);
+	}
 }
 
-bool APickup::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
+void APickup::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	bool bWroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
-
-	if (Item && Channel->KeyNeedsToReplicate(Item->GetUniqueID(), Item->RepKey))
-	{
-		bWroteSomething |= Channel->ReplicateSubobject(Item, *Bunch, *RepFlags);
-	}
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	return bWroteSomething;
+	SURVIVAL_DOREPLIFETIME_PUSH(APickup, PickupItem);
+	SURVIVAL_DOREPLIFETIME_PUSH(APickup, bPooled);
 }
 
 #if WITH_EDITOR
@@ -119,6 +241,34 @@ void APickup::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent
 }
 #endif
 
+bool APickup::IsInUse() const
+{
+	return InteractionComponent && InteractionComponent->HasInteractors();
+}
+
+bool APickup::CouldBeFocused() const
+{
+	if (!InteractionComponent)
+	{
+		return false;
+	}
+
+	const float FocusDistanceSq = FMath::Square(InteractionComponent->InteractionDistance);
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+
+		if (Pawn && FVector::DistSquared(Pawn->GetActorLocation(), GetActorLocation()) <= FocusDistanceSq)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void APickup::OnTakePickup(ASurvivalCharacter* Taker)
 {
 	if (!Taker)
@@ -127,19 +277,33 @@ void APickup::OnTakePickup(ASurvivalCharacter* Taker)
 		return;
 	}
 
-	if (HasAuthority() && !IsPendingKillPending() && Item)
+	if (HasAuthority() && !IsPendingKillPending() && !bPooled && PickupItem.ItemClass)
 	{
 		if (UInventoryComponent* PlayerInventory = Taker->PlayerInventory)
 		{
-			const FItemAddResult AddResult = PlayerInventory->TryAddItem(Item);
+			// The inventory creates the actual item object
+			const FItemAddResult AddResult = PlayerInventory->TryAddItemFromClass(PickupItem.ItemClass, PickupItem.Quantity);
 
-			if (AddResult.ActualAmountGiven < Item->GetQuantity())
+			if (AddResult.ActualAmountGiven < PickupItem.Quantity)
 			{
-				Item->SetQuantity(Item->GetQuantity() - AddResult.ActualAmountGiven);
+				SetQuantity(PickupItem.Quantity - AddResult.ActualAmountGiven);
 			}
-			else if (AddResult.ActualAmountGiven >= Item->GetQuantity())
+			else if (AddResult.ActualAmountGiven >= PickupItem.Quantity)
 			{
-				Destroy();
+				if (ALootSpawnPoint* LootSpawnPoint = SpawnPoint.Get())
+				{
+					LootSpawnPoint->OnLootTaken();
+				}
+
+				if (DropTime >= 0.f)
+				{
+					if (UWorldItemManagerComponent* WorldItemManager = UWorldItemManagerComponent::Get(this))
+					{
+						WorldItemManager->OnDroppedItemTaken();
+					}
+				}
+
+				ReleaseOrDestroy();
 			}
 		}
 	}
@@ -4,10 +4,45 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Components/InteractableInterface.h"
 #include "Pickup.generated.h"
 
+// The item a pickup holds. Pickups only need this much to draw and to be taken, so no item object is created until the item goes into an inventory
+USTRUCT(BlueprintType)
+struct FPickupItem
+{
+	GENERATED_BODY()
+
+	FPickupItem()
+	{
+		ItemClass = nullptr;
+		Quantity = 0;
+	}
+
+	FPickupItem(TSubclassOf<class UItem> InItemClass, const int32 InQuantity)
+		: ItemClass(InItemClass), Quantity(InQuantity)
+	{}
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pickup")
+	TSubclassOf<class UItem> ItemClass;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Pickup")
+	int32 Quantity;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FPickupItem> : public TStructOpsTypeTraitsBase2<FPickupItem>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
 UCLASS()
-class SURVIVALGAME_API APickup : public AActor
+class SURVIVALGAME_API APickup : public AActor, public IInteractableInterface
 {
 	GENERATED_BODY()
 	
@@ -26,22 +61,66 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Instanced)
 	class UItem* ItemTemplate;
 
+	FORCEINLINE TSubclassOf<class UItem> GetItemClass() const { return PickupItem.ItemClass; }
+	FORCEINLINE int32 GetQuantity() const { return PickupItem.Quantity; }
+
+	// IInteractableInterface
+	virtual class UInteractionComponent* GetActorInteractionComponent() const override { return InteractionComponent; }
+
+	// True if a player is currently interacting with the pickup
+	bool IsInUse() const;
+
+	// [server] True if a player is close enough to have the pickup focused. The server isn't told about focus, so this goes on distance
+	bool CouldBeFocused() const;
+
+	// [server] Change how much of the item is left in the pickup
+	void SetQuantity(const int32 NewQuantity);
+
+	// [server] Called by the pickup pool when the pickup is put back in the pool or handed out again
+	void SetPooled(const bool bNewPooled);
+
+	FORCEINLINE bool IsPooled() const { return bPooled; }
+
+	// Goes up every time the pickup is pooled, so anything holding on to the pickup can tell it has since been reused
+	FORCEINLINE int32 GetPoolSerial() const { return PoolSerial; }
+
+	// [server] Put the pickup back in the pickup pool if there is one, otherwise destroy it
+	void ReleaseOrDestroy();
+
+	// [server] Wake the pickup from dormancy so changes to it replicate. Must be called after changing any replicated property
+	void MarkDirtyForReplication();
+
+	// [server] The time a player dropped the item in this pickup, or -1 if it was placed by the level. Old drops get despawned
+	float DropTime;
+
+	// [server] The loot spawn point that spawned the item in this pickup, if any
+	TWeakObjectPtr<class ALootSpawnPoint> SpawnPoint;
+
 protected:
 
-	UPROPERTY(BlueprintReadWrite, VisibleAnywhere, ReplicatedUsing = OnRep_Item)
-	class UItem* Item;
+	// Pooled pickups are hidden and can't be interacted with until they are handed out again
+	UPROPERTY(ReplicatedUsing = OnRep_Pooled)
+	bool bPooled;
+
+	int32 PoolSerial;
 
 	UFUNCTION()
-	void OnRep_Item();
+	void OnRep_Pooled();
+
+	UPROPERTY(VisibleAnywhere, ReplicatedUsing = OnRep_PickupItem)
+	FPickupItem PickupItem;
 
 	UFUNCTION()
-	void OnItemModified();
+	void OnRep_PickupItem();
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Whether this pickup was counted in the dormant pickups stat
+	bool bCountedAsDormant;
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
-	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
 
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
@@ -0,0 +1,178 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WorldItemCell.h"
+#include "Items/Item.h"
+#include "Net/UnrealNetwork.h"
+#include "Components/InstancedStaticMeshComponent.h"
+
+void FWorldItemEntry::PreReplicatedRemove(const FWorldItemArray& InArraySerializer)
+{
+	if (InArraySerializer.OwningCell)
+	{
+		InArraySerializer.OwningCell->RemoveItemInstance(ItemId);
+	}
+}
+
+void FWorldItemEntry::PostReplicatedAdd(const FWorldItemArray& InArraySerializer)
+{
+	if (InArraySerializer.OwningCell)
+	{
+		InArraySerializer.OwningCell->AddItemInstance(*this);
+	}
+}
+
+AWorldItemCell::AWorldItemCell()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	SetRootComponent(CreateDefaultSubobject<USceneComponent>("Root"));
+
+	WorldItems.OwningCell = this;
+	NextItemId = 0;
+
+	SetReplicates(true);
+}
+
+int32 AWorldItemCell::AddItem(TSubclassOf<UItem> ItemClass, const int32 Quantity, const FTransform& Transform, const float DropTime, ALootSpawnPoint* SpawnPoint)
+{
+	if (HasAuthority() && ItemClass && Quantity > 0)
+	{
+		FWorldItemEntry& Entry = WorldItems.Items.AddDefaulted_GetRef();
+		Entry.ItemId = NextItemId++;
+		Entry.ItemClass = ItemClass;
+		Entry.Quantity = Quantity;
+		Entry.Location = Transform.GetLocation();
+		Entry.Rotation = Transform.Rotator();
+		Entry.DropTime = DropTime;
+		Entry.SpawnPoint = SpawnPoint;
+
+		WorldItems.MarkItemDirty(Entry);
+		AddItemInstance(Entry);
+
+		return Entry.ItemId;
+	}
+
+	return INDEX_NONE;
+}
+
+bool AWorldItemCell::RemoveItem(const int32 ItemId, FWorldItemEntry& OutEntry)
+{
+	if (HasAuthority())
+	{
+		const int32 EntryIndex = WorldItems.Items.IndexOfByPredicate([ItemId](const FWorldItemEntry& Entry)
+		{
+			return Entry.ItemId == ItemId;
+		});
+
+		if (WorldItems.Items.IsValidIndex(EntryIndex))
+		{
+			OutEntry = WorldItems.Items[EntryIndex];
+			WorldItems.Items.RemoveAtSwap(EntryIndex);
+			WorldItems.MarkArrayDirty();
+			RemoveItemInstance(ItemId);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const FWorldItemEntry* AWorldItemCell::FindItem(const int32 ItemId) const
+{
+	return WorldItems.Items.FindByPredicate([ItemId](const FWorldItemEntry& Entry)
+	{
+		return Entry.ItemId == ItemId;
+	});
+}
+
+FWorldItemEntry* AWorldItemCell::FindItem(const int32 ItemId)
+{
+	return WorldItems.Items.FindByPredicate([ItemId](const FWorldItemEntry& Entry)
+	{
+		return Entry.ItemId == ItemId;
+	});
+}
+
+bool AWorldItemCell::SetItemQuantity(const int32 ItemId, const int32 NewQuantity)
+{
+	if (HasAuthority() && NewQuantity > 0)
+	{
+		if (FWorldItemEntry* Entry = FindItem(ItemId))
+		{
+			Entry->Quantity = NewQuantity;
+			WorldItems.MarkItemDirty(*Entry);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void AWorldItemCell::AddItemInstance(const FWorldItemEntry& Entry)
+{
+	// The dedicated server never draws the items
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	const UItem* ItemCDO = Entry.ItemClass ? Entry.ItemClass->GetDefaultObject<UItem>() : nullptr;
+
+	if (!ItemCDO || !ItemCDO->PickupMesh)
+	{
+		return;
+	}
+
+	UInstancedStaticMeshComponent*& MeshComponent = MeshComponents.FindOrAdd(ItemCDO->PickupMesh);
+
+	if (!MeshComponent)
+	{
+		MeshComponent = NewObject<UInstancedStaticMeshComponent>(this);
+		MeshComponent->SetStaticMesh(ItemCDO->PickupMesh);
+		MeshComponent->SetCollisionResponseToChannel(ECC_Pawn, ECR_Ignore);
+
+		// One overlap for the whole component rather than one per instance, players only need to know the cell has items near them
+		MeshComponent->bMultiBodyOverlap = false;
+		MeshComponent->SetGenerateOverlapEvents(true);
+		MeshComponent->SetupAttachment(GetRootComponent());
+		MeshComponent->RegisterComponent();
+	}
+
+	MeshComponent->AddInstanceWorldSpace(Entry.GetTransform());
+	InstanceItemIds.FindOrAdd(MeshComponent).Add(Entry.ItemId);
+
+	// Adding an instance doesn't move the component, so nothing checks for overlaps by itself. Without this a player standing
+	// next to a new or refilled cell would never get a begin overlap for it
+	MeshComponent->UpdateOverlaps();
+}
+
+void AWorldItemCell::RemoveItemInstance(const int32 ItemId)
+{
+	for (auto& ItemIds : InstanceItemIds)
+	{
+		const int32 InstanceIndex = ItemIds.Value.IndexOfByKey(ItemId);
+
+		if (InstanceIndex != INDEX_NONE)
+		{
+			// Removing an instance shifts the ones after it down, so keep the ids in the same order
+			ItemIds.Key->RemoveInstance(InstanceIndex);
+			ItemIds.Value.RemoveAt(InstanceIndex);
+
+			// Let nearby players forget the component once it has nothing left to pick up
+			if (ItemIds.Value.Num() == 0)
+			{
+				ItemIds.Key->UpdateOverlaps();
+			}
+			return;
+		}
+	}
+}
+
+void AWorldItemCell::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AWorldItemCell, WorldItems);
+}
@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Engine/NetSerialization.h"
+#include "WorldItemCell.generated.h"
+
+// An item lying in the world that doesn't have an actor of its own
+USTRUCT()
+struct FWorldItemEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	FWorldItemEntry()
+	{
+		ItemId = INDEX_NONE;
+		ItemClass = nullptr;
+		Quantity = 0;
+		DropTime = -1.f;
+	}
+
+	// Unique within the cell. Clients use this to tell the server which item they are looking at
+	UPROPERTY()
+	int32 ItemId;
+
+	UPROPERTY()
+	TSubclassOf<class UItem> ItemClass;
+
+	UPROPERTY()
+	int32 Quantity;
+
+	UPROPERTY()
+	FVector_NetQuantize10 Location;
+
+	UPROPERTY()
+	FRotator Rotation;
+
+	// [server] The time a player dropped the item, or -1 if it was placed by the level
+	UPROPERTY(NotReplicated)
+	float DropTime;
+
+	// [server] The loot spawn point that spawned the item, if any. Told when the item is taken so it can respawn
+	TWeakObjectPtr<class ALootSpawnPoint> SpawnPoint;
+
+	FORCEINLINE FTransform GetTransform() const { return FTransform(Rotation, Location); }
+
+	void PreReplicatedRemove(const struct FWorldItemArray& InArraySerializer);
+	void PostReplicatedAdd(const struct FWorldItemArray& InArraySerializer);
+};
+
+USTRUCT()
+struct FWorldItemArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FWorldItemEntry> Items;
+
+	// The cell that owns this array, so replication callbacks can update its meshes
+	class AWorldItemCell* OwningCell;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FWorldItemEntry, FWorldItemArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FWorldItemArray> : public TStructOpsTypeTraitsBase2<FWorldItemArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true
+	};
+};
+
+/**
+ * Holds every actorless world item inside one cell of the world item grid. Items are replicated together as a fast array,
+ * and drawn with one instanced static mesh component per pickup mesh. Cells are spawned by UWorldItemManagerComponent.
+ */
+UCLASS(NotBlueprintable)
+class SURVIVALGAME_API AWorldItemCell : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AWorldItemCell();
+
+	// [server] Add an item to the cell. Returns the id of the new item
+	int32 AddItem(TSubclassOf<class UItem> ItemClass, const int32 Quantity, const FTransform& Transform, const float DropTime = -1.f, class ALootSpawnPoint* SpawnPoint = nullptr);
+
+	// [server] Remove an item from the cell, copying it into OutEntry
+	bool RemoveItem(const int32 ItemId, FWorldItemEntry& OutEntry);
+
+	const FWorldItemEntry* FindItem(const int32 ItemId) const;
+	FWorldItemEntry* FindItem(const int32 ItemId);
+
+	// [server] Change how much of an item there is
+	bool SetItemQuantity(const int32 ItemId, const int32 NewQuantity);
+
+	FORCEINLINE int32 GetNumItems() const { return WorldItems.Items.Num(); }
+	FORCEINLINE const TArray<FWorldItemEntry>& GetItems() const { return WorldItems.Items; }
+
+	// Add or remove the one mesh instance that draws an item. Nothing is drawn on a dedicated server
+	void AddItemInstance(const FWorldItemEntry& Entry);
+	void RemoveItemInstance(const int32 ItemId);
+
+	// The grid coordinate of this cell
+	UPROPERTY()
+	FIntVector CellCoord;
+
+protected:
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	UPROPERTY(Replicated)
+	FWorldItemArray WorldItems;
+
+	// One instanced mesh component for every pickup mesh in the cell
+	UPROPERTY()
+	TMap<class UStaticMesh*, class UInstancedStaticMeshComponent*> MeshComponents;
+
+	// Which item each mesh instance belongs to, by instance index
+	TMap<class UInstancedStaticMeshComponent*, TArray<int32>> InstanceItemIds;
+
+	int32 NextItemId;
+
+};